@@ -19,13 +19,15 @@
 /***      int AssignRight()                                      ***/
 /***      int PrintAE()                                          ***/
 /***  PRIVATE ROUTINES:                                          ***/
-/***      int LeftTapAE()                                        ***/
 /***      int CopyAE()                                           ***/
 /***  MODULE DESCRIPTION:                                        ***/
 /***      This module contains routines dealing with Algebraic   ***/
 /***      elements.                                              ***/
 /*******************************************************************/
 
+#include <algorithm>
+#include <vector>
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -36,35 +38,152 @@
 #include "Mult_table.h"
 #include "Scalar_arithmetic.h"
 
-using std::map;
+using std::vector;
 
-static void clearZeros(Alg_element &p2);
-static int LeftTapAE(Scalar x, Basis b, const Alg_element &p1, Alg_element &p2);
 #if 1
 void PrintAE(const Alg_element &p);
 #endif
 
+/* Blocks of terms of the longer elements, kept by each thread for reuse in size classes of powers of two.
+   A block goes to the pool of the thread dropping it, which need not be the one that took it. */
+class TermPool {
+public:
+    ~TermPool() {
+        for (auto &blocks : free_blocks) {
+            for (auto *block : blocks) free(block);
+        }
+    }
+
+    Alg_element::value_type *take(int &cap) {
+        int k = SizeClass(cap);
+        cap = 1 << k;
+        if (k < Num_classes && !free_blocks[k].empty()) {
+            Alg_element::value_type *block = free_blocks[k].back();
+            free_blocks[k].pop_back();
+            return block;
+        }
+        return (Alg_element::value_type *) malloc(cap * sizeof(Alg_element::value_type));
+    }
+
+    void give(Alg_element::value_type *block, int cap) {
+        int k = SizeClass(cap);
+        if (k < Num_classes && (int) free_blocks[k].size() < Max_blocks) {
+            free_blocks[k].push_back(block);
+        } else {
+            free(block);
+        }
+    }
+
+private:
+    static const int Num_classes = 16;
+    static const int Max_blocks = 256;      /* Per size class. */
+
+    static int SizeClass(int cap) {
+        int k = 3;
+        while ((1 << k) < cap) k++;
+        return k;
+    }
+
+    vector<Alg_element::value_type *> free_blocks[Num_classes];
+};
+
+static thread_local TermPool Term_pool;
+
+void Alg_element::grow(int c) {
+    int new_cap = std::max(c, 2 * cap);
+    value_type *new_terms = Term_pool.take(new_cap);
+    memcpy(new_terms, terms, n * sizeof(value_type));
+    release();
+    terms = new_terms;
+    cap = new_cap;
+}
+
+void Alg_element::release() {
+    if (terms != inline_terms) {
+        Term_pool.give(terms, cap);
+        terms = inline_terms;
+        cap = Inline_terms;
+    }
+}
+
+void Alg_element::swap(Alg_element &p) noexcept {
+    if (terms != inline_terms && p.terms != p.inline_terms) {
+        std::swap(terms, p.terms);
+        std::swap(n, p.n);
+        std::swap(cap, p.cap);
+    } else {
+        Alg_element t;
+        t.reserve(n);
+        memcpy(t.terms, terms, n * sizeof(value_type));
+        t.n = n;
+        if (p.terms != p.inline_terms) {
+            release();
+            terms = p.terms;
+            cap = p.cap;
+            p.terms = p.inline_terms;
+            p.cap = Inline_terms;
+        } else {
+            memcpy(terms, p.terms, p.n * sizeof(value_type));
+        }
+        n = p.n;
+        p.n = 0;
+        p.reserve(t.n);
+        memcpy(p.terms, t.terms, t.n * sizeof(value_type));
+        p.n = t.n;
+    }
+}
+
+/* Products are summed in a dense accumulator over the basis, of the thread, holding the coefficients of
+   the basis elements touched so far. The terms are then gathered in order of basis. */
+class ProductAccumulator {
+public:
+    ProductAccumulator() : coef(), used(), touched() {}
+
+    void add(Basis b, Scalar x) {
+        if (b >= (int) coef.size()) {
+            coef.resize(2 * b + 1, S_zero());
+            used.resize(2 * b + 1, 0);
+        }
+        if (!used[b]) {
+            used[b] = 1;
+            coef[b] = x;
+            touched.push_back(b);
+        } else {
+            coef[b] = S_add(coef[b], x);
+        }
+    }
+
+    /* Replace p with the sum, and reset. */
+    void gather(Alg_element &p) {
+        std::sort(touched.begin(), touched.end());
+        p.clear();
+        p.reserve(touched.size());
+        for (Basis b : touched) {
+            if (b != 0 && coef[b] != S_zero()) {
+                p.push_back(Alg_element::value_type(b, coef[b]));
+            }
+            used[b] = 0;
+        }
+        touched.clear();
+    }
+
+private:
+    vector<Scalar> coef;
+    vector<char> used;
+    vector<Basis> touched;
+};
+
+static thread_local ProductAccumulator Accumulator;
+
+/* Drop the terms of zero coef or basis. */
 static void clearZeros(Alg_element &p) {
-#if 0
-    int ne = p.size();
-    int nz = 0;
-#endif
-    map<Basis, Scalar>::iterator i;
-    for(i = p.begin(); i != p.end();) {
-      if(i->first == 0 || i->second == 0) {
-        p.erase(i++);
-#if 0
-        nz++;
-#endif
-      } else {
-        i++;
-      } 
+    int k = 0;
+    for (const auto &t : p) {
+        if (t.first != 0 && t.second != 0) {
+            *(p.begin() + k++) = t;
+        }
     }
-#if 0
-  if(nz > 0) {
-      printf("%d of %d zero coef or basis terms removed\n", nz, ne);
-  }
-#endif
+    p.truncate(k);
 }
 
 /*******************************************************************/
@@ -77,7 +196,7 @@ static void clearZeros(Alg_element &p) {
 /*******************************************************************/ 
 int IsZeroAE(const Alg_element &p)
 {
-    map<Basis, Scalar>::const_iterator i;
+    Alg_element::const_iterator i;
     for(i = p.begin(); i != p.end(); i++) {
       if(i->first != 0 && i->second != 0) return 0;
     }
@@ -103,7 +222,7 @@ void ScalarMultAE(Scalar x, Alg_element &p)
     } else if (x == S_zero()) {
         p.clear();
     } else {
-      map<Basis, Scalar>::iterator i;
+      Alg_element::iterator i;
       for(i = p.begin(); i != p.end(); i++) {
         i->second = S_mul(x, i->second);
       }
@@ -128,72 +247,28 @@ void ScalarMultAE(Scalar x, Alg_element &p)
 /*******************************************************************/ 
 void AddAE(const Alg_element &p1, Alg_element &p2)
 {
-      map<Basis, Scalar>::const_iterator p1i = p1.begin();
-      map<Basis, Scalar>::iterator p2i = p2.begin();
-      
-    while(p1i != p1.end()) {
-      if(p2i == p2.end()) {  /* occurs if max_basis(p2) < max_basis(p1) */
-        p2[p1i->first] = p1i->second;
+    Alg_element sum;
+    sum.reserve(p1.size() + p2.size());
 
-        p1i++;
-#if 0
-      } else if(p2i->first == 0) {
-        p2i->first = p1i->first;
-        p2i->second = p1i->second;
-
-        p1i++;
-        p2i++;
-#endif
-      } else if(p2i->first == p1i->first) {
-        p2i->second = S_add(p2i->second, p1i->second);
+    Alg_element::const_iterator p1i = p1.begin();
+    Alg_element::const_iterator p2i = p2.begin();
 
+    while(p1i != p1.end() || p2i != p2.end()) {
+      if(p2i == p2.end() || (p1i != p1.end() && p1i->first < p2i->first)) {
+        sum.push_back(*p1i++);
+      } else if(p1i == p1.end() || p2i->first < p1i->first) {
+        sum.push_back(*p2i++);
+      } else {
+        sum.push_back(Alg_element::value_type(p2i->first, S_add(p2i->second, p1i->second)));
         p1i++;
         p2i++;
-      } else if(p2i->first < p1i->first) {
-        p2i++;
-      } else if(p2i->first > p1i->first) {
-        p2[p1i->first] = p1i->second;
-
-        p1i++;
-      }
-    }
-
-    clearZeros(p2);
-}    
-
-/*******************************************************************/
-/* MODIFIES:                                                       */
-/*     *p2 -- Alg_element.                                         */ 
-/* REQUIRES:                                                       */
-/*     x -- Coefficient of the term.                               */
-/*     b -- Basis of the term.                                     */ 
-/*     *p1 -- Alg_element used for multiplication.                 */
-/* RETURNS:                                                        */
-/*     1 if successfull.                                           */
-/*     0 otherwise.                                                */
-/* FUNCTION:                                                       */
-/*     Multiply term with Alg_element *p1 and add to *p2.          */
-/*         *p2 = xb.(*p1) + *p2                                    */
-/*******************************************************************/ 
-int LeftTapAE(Scalar x, Basis b, const Alg_element &p1, Alg_element &p2)
-{
-    int status = OK;
-
-    const Scalar zero = S_zero();
-    if (x != zero && !IsZeroAE(p1)) {
-      map<Basis, Scalar>::const_iterator i;
-      for(i = p1.begin(); i != p1.end(); i++) {
-        if(i->second != zero) {
-                if (status == OK)
-                    status = Mult2basis(b, i->first, S_mul(x, i->second), p2); 
-            }
       }
     }
-    clearZeros(p2);
 
-        return(status);
+    clearZeros(sum);
+    p2.swap(sum);
 }
-    
+
 /*******************************************************************/
 /* MODIFIES:                                                       */
 /*     *p3 -- Alg_element.                                         */ 
@@ -212,13 +287,34 @@ int MultAE(const Alg_element &p1, const Alg_element &p2, Alg_element &p3)
 
     const Scalar zero = S_zero();
     if (!IsZeroAE(p1) && !IsZeroAE(p2)) {
-      map<Basis, Scalar>::const_iterator p1i;
-      for(p1i = p1.begin(); p1i != p1.end(); p1i++) {
-        if(p1i->second != zero) {
-                if (status == OK)
-                    status = LeftTapAE(p1i->second, p1i->first, p2, p3); 
-            }
+      const MultTable &mult_table = CurrentSession().mult_table;
+      Product_terms prod;
+
+      for (const auto &t : p3) {
+        Accumulator.add(t.first, t.second);
+      }
+
+      Alg_element::const_iterator p1i, p2i;
+      for(p1i = p1.begin(); p1i != p1.end() && status == OK; p1i++) {
+        if(p1i->second == zero)
+          continue;
+        for(p2i = p2.begin(); p2i != p2.end(); p2i++) {
+          if(p2i->second == zero)
+            continue;
+
+          if (!mult_table.find(p1i->first, p2i->first, prod)) {
+            status = 0;
+            break;
+          }
+
+          const Scalar x = S_mul(p1i->second, p2i->second);
+          for (const auto &t : prod) {
+            Accumulator.add(t.first, S_mul(x, t.second));
+          }
         }
+      }
+
+      Accumulator.gather(p3);
     }
     clearZeros(p3);
 
@@ -238,7 +334,7 @@ int MultAE(const Alg_element &p1, const Alg_element &p2, Alg_element &p3)
 /*******************************************************************/ 
 void PrintAE(const Alg_element &p)
 {
-    map<Basis, Scalar>::const_iterator pi;
+    Alg_element::const_iterator pi;
     for(pi = p.begin(); pi != p.end(); pi++) {
          Basis basis = pi->first;
          Scalar coef = pi->second;
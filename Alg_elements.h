@@ -8,12 +8,109 @@
 /***                    Changed basis_coef from array to ptr     ***/
 /*******************************************************************/
 
-#include <map>
+#include <algorithm>
+#include <utility>
+
+#include <string.h>
 
 #include "Build_defs.h"
 #include "Scalar_arithmetic.h"
 
-typedef std::map<Basis, Scalar> Alg_element; // basis -> coef
+/* A term (basis, coef) of an element. It is trivially copyable, so terms are moved with memcpy and kept in
+   raw blocks. */
+struct Alg_term {
+    Alg_term() = default;
+    Alg_term(Basis b, Scalar x) : first(b), second(x) {}
+
+    Basis first;
+    Scalar second;
+};
+
+/* An element of the algebra, its terms (basis, coef) in increasing order of basis. Up to Inline_terms
+   terms are kept in the element itself. Longer elements keep them in blocks taken from a pool of the
+   thread, see Alg_elements.cpp, so building and dropping elements seldom reaches malloc. */
+class Alg_element {
+public:
+    typedef Alg_term value_type;
+    typedef value_type *iterator;
+    typedef const value_type *const_iterator;
+
+    Alg_element() : terms(inline_terms), n(0), cap(Inline_terms) {}
+    Alg_element(const Alg_element &p) : Alg_element() { *this = p; }
+    Alg_element(Alg_element &&p) noexcept : Alg_element() { swap(p); }
+    ~Alg_element() { release(); }
+
+    Alg_element &operator=(const Alg_element &p) {
+        if (this != &p) {
+            n = 0;
+            reserve(p.n);
+            memcpy(terms, p.terms, p.n * sizeof(value_type));
+            n = p.n;
+        }
+        return *this;
+    }
+
+    Alg_element &operator=(Alg_element &&p) noexcept {
+        swap(p);
+        return *this;
+    }
+
+    void swap(Alg_element &p) noexcept;
+
+    iterator begin() { return terms; }
+    iterator end() { return terms + n; }
+    const_iterator begin() const { return terms; }
+    const_iterator end() const { return terms + n; }
+    int size() const { return n; }
+    bool empty() const { return n == 0; }
+    void clear() { n = 0; }
+
+    iterator lower_bound(Basis b) {
+        return std::lower_bound(begin(), end(), b, [](const value_type &t, Basis b) { return t.first < b; });
+    }
+    const_iterator lower_bound(Basis b) const {
+        return std::lower_bound(begin(), end(), b, [](const value_type &t, Basis b) { return t.first < b; });
+    }
+
+    /* Room for c terms, keeping the terms. */
+    void reserve(int c) {
+        if (c > cap) grow(c);
+    }
+
+    /* Append a term of basis beyond those of the element. */
+    void push_back(const value_type &t) {
+        if (n == cap) grow(n + 1);
+        terms[n++] = t;
+    }
+
+    iterator insert(iterator pos, const value_type &t) {
+        int i = pos - terms;
+        if (n == cap) grow(n + 1);
+        memmove(terms + i + 1, terms + i, (n - i) * sizeof(value_type));
+        terms[i] = t;
+        n++;
+        return terms + i;
+    }
+
+    void erase(iterator pos) {
+        memmove(pos, pos + 1, (end() - pos - 1) * sizeof(value_type));
+        n--;
+    }
+
+    /* Keep the first c terms. */
+    void truncate(int c) { n = c; }
+
+private:
+    static const int Inline_terms = 4;
+
+    void grow(int c);
+    void release();
+
+    value_type *terms;
+    int n;
+    int cap;
+    value_type inline_terms[Inline_terms];
+};
 
 int IsZeroAE(const Alg_element &p);
 void ScalarMultAE(Scalar x, Alg_element &p);
@@ -21,24 +118,30 @@ void AddAE(const Alg_element &p1, Alg_element &p2);
 int MultAE(const Alg_element &p1, const Alg_element &p2, Alg_element &p3);
 
 inline void SetAE(Alg_element &p, Basis b, Scalar x) {
-  if(x != S_zero()) {
-    p[b] = x;
-  } else {
-    p.erase(b);
+  Alg_element::iterator i = p.lower_bound(b);
+
+  if(i != p.end() && i->first == b) {
+    if(x != S_zero()) {
+      i->second = x;
+    } else {
+      p.erase(i);
+    }
+  } else if(x != S_zero()) {
+    p.insert(i, Alg_element::value_type(b, x));
   }
 }
 
 inline Scalar GetAE(const Alg_element &p, Basis b) {
-  std::map<Basis, Scalar>::const_iterator i = p.find(b);
+  Alg_element::const_iterator i = p.lower_bound(b);
 
-  return i != p.end() ? i->second : S_zero();
+  return i != p.end() && i->first == b ? i->second : S_zero();
 }
 
 inline void AccumAE(Alg_element &p, Basis b, Scalar x) {
   if(b != 0 && x != S_zero()) {
-    std::map<Basis, Scalar>::iterator i = p.find(b);
+    Alg_element::iterator i = p.lower_bound(b);
 
-    if(i != p.end()) {
+    if(i != p.end() && i->first == b) {
       x = S_add(i->second, x);
       if(x != S_zero()) {
         i->second = x;
@@ -46,7 +149,7 @@ inline void AccumAE(Alg_element &p, Basis b, Scalar x) {
         p.erase(i);
       }
     } else {
-      p[b] = x;
+      p.insert(i, Alg_element::value_type(b, x));
     }
   }
 }
@@ -33,20 +33,12 @@ using std::make_pair;
 #include "Generators.h"
 #include "Help.h"
 #include "Memory_routines.h"
+#include "Session.h"
 #include "Type_table.h"
 
 static void UpdateDegToBasisTable(int Deg, Basis Cur_basis);
 static void PrintBasis(Basis b, FILE *filePtr);
 
-typedef struct {
-    Basis left_factor;
-    Basis right_factor;
-    Name type;
-} BT_rec;
-
-static vector<BT_rec> Basis_table;
-static vector<pair<Basis, Basis> > Deg_to_basis_table; // maps degree to first and last indices in Basis_table associated with that degree
-
 /*******************************************************************/
 /* GLOBALS INITIALIZED:                                            */
 /*     Basis_table -- to zeroes.                                   */
@@ -61,16 +53,17 @@ static vector<pair<Basis, Basis> > Deg_to_basis_table; // maps degree to first a
 /*******************************************************************/ 
 int CreateBasisTable()
 {
-    Basis_table.clear();
+    BasisTableState &bt = CurrentSession().basis;
+    bt.Basis_table.clear();
     { // First entry is expected to be zero, but this may not be required
       BT_rec br;
       br.left_factor = 0;
       br.right_factor = 0;
       br.type = 0; 
-      Basis_table.push_back(br);
+      bt.Basis_table.push_back(br);
     }
 
-    Deg_to_basis_table.clear();
+    bt.Deg_to_basis_table.clear();
 
     return OK;
 }
@@ -92,13 +85,14 @@ int CreateBasisTable()
 /*******************************************************************/ 
 Basis EnterBasis(Basis Left_factor, Basis Right_factor, Name Cur_type)
 {
-    Basis bn = Basis_table.size();
+    BasisTableState &bt = CurrentSession().basis;
+    Basis bn = bt.Basis_table.size();
 
     BT_rec br;
     br.left_factor = Left_factor;
     br.right_factor = Right_factor;
     br.type = Cur_type; 
-    Basis_table.push_back(br);
+    bt.Basis_table.push_back(br);
 
     UpdateDegToBasisTable(GetDegreeName(Cur_type), bn);
 
@@ -108,10 +102,11 @@ Basis EnterBasis(Basis Left_factor, Basis Right_factor, Name Cur_type)
 
 void UpdateDegToBasisTable(int Deg, Basis Cur_basis)
 {
-    if(Deg > (int)Deg_to_basis_table.size()) {
-      Deg_to_basis_table.push_back(make_pair(Cur_basis, Cur_basis));
+    BasisTableState &bt = CurrentSession().basis;
+    if(Deg > (int)bt.Deg_to_basis_table.size()) {
+      bt.Deg_to_basis_table.push_back(make_pair(Cur_basis, Cur_basis));
     } else {
-      Deg_to_basis_table[Deg-1].second++;
+      bt.Deg_to_basis_table[Deg-1].second++;
     }
 }
 
@@ -123,19 +118,23 @@ void UpdateDegToBasisTable(int Deg, Basis Cur_basis)
 /*******************************************************************/ 
 Basis GetNextBasisTobeFilled()
 {
-    return Basis_table.size();
+    BasisTableState &bt = CurrentSession().basis;
+    return bt.Basis_table.size();
 }
 
 
+/* A degree beyond those with basis elements, as in a nilpotent algebra, has the empty range 0 to -1. */
 Basis BasisStart(Degree Deg)
 {
-    return Deg_to_basis_table[Deg-1].first;
+    BasisTableState &bt = CurrentSession().basis;
+    return Deg <= (int)bt.Deg_to_basis_table.size() ? bt.Deg_to_basis_table[Deg-1].first : 0;
 }
 
 
 Basis BasisEnd(Degree Deg)
 {
-    return Deg_to_basis_table[Deg-1].second;
+    BasisTableState &bt = CurrentSession().basis;
+    return Deg <= (int)bt.Deg_to_basis_table.size() ? bt.Deg_to_basis_table[Deg-1].second : -1;
 }
 
 
@@ -148,7 +147,28 @@ Basis BasisEnd(Degree Deg)
 /*******************************************************************/ 
 Name GetType(Basis B)
 {
-    return Basis_table[B].type;
+    BasisTableState &bt = CurrentSession().basis;
+    return bt.Basis_table[B].type;
+}
+
+
+/*******************************************************************/
+/* MODIFIES: None.                                                 */
+/* REQUIRES:                                                       */
+/*     B -- Basis element.                                         */
+/* RETURNS:                                                        */
+/*     Factors of the product defining B, 0 for generators.        */
+/*******************************************************************/ 
+Basis LeftFactor(Basis B)
+{
+    BasisTableState &bt = CurrentSession().basis;
+    return bt.Basis_table[B].left_factor;
+}
+
+Basis RightFactor(Basis B)
+{
+    BasisTableState &bt = CurrentSession().basis;
+    return bt.Basis_table[B].right_factor;
 }
 
 
@@ -162,12 +182,13 @@ Name GetType(Basis B)
 /*******************************************************************/ 
 void PrintBasisTable(FILE *filePtr) /* TW 9/19/93 - added 2 params to support view, save, & output */
 {
-  if(Basis_table.size() > 1){
+  BasisTableState &bt = CurrentSession().basis;
+  if(bt.Basis_table.size() > 1){
     fprintf(filePtr, "Basis Table: \n");
-    for (int i=1; i<(int)Basis_table.size(); i++) {
-         fprintf(filePtr, " %3d.   %3d %3d   ",i,Basis_table[i].left_factor,
-                             Basis_table[i].right_factor);
-         PrintTypeName(Basis_table[i].type, filePtr);
+    for (int i=1; i<(int)bt.Basis_table.size(); i++) {
+         fprintf(filePtr, " %3d.   %3d %3d   ",i,bt.Basis_table[i].left_factor,
+                             bt.Basis_table[i].right_factor);
+         PrintTypeName(bt.Basis_table[i].type, filePtr);
          fprintf(filePtr, "    ");
          PrintBasis(i, filePtr);
          fprintf(filePtr, "\n");
@@ -185,14 +206,15 @@ void PrintBasisTable(FILE *filePtr) /* TW 9/19/93 - added 2 params to support vi
 /*******************************************************************/ 
 void PrintBasis(Basis b, FILE *filePtr) /* TW 9/19/93 - added param to support view, save, & output */
 {
+    BasisTableState &bt = CurrentSession().basis;
 
-    if ( (Basis_table[b].left_factor == 0) && 
-         (Basis_table[b].right_factor == 0) ) {
+    if ( (bt.Basis_table[b].left_factor == 0) && 
+         (bt.Basis_table[b].right_factor == 0) ) {
         fprintf(filePtr, "%c", GetLetterofBasis(b) );
     } else {
         fprintf(filePtr, "(");
-        PrintBasis(Basis_table[b].left_factor, filePtr);
-        PrintBasis(Basis_table[b].right_factor, filePtr);
+        PrintBasis(bt.Basis_table[b].left_factor, filePtr);
+        PrintBasis(bt.Basis_table[b].right_factor, filePtr);
         fprintf(filePtr, ")");
     }
 }
@@ -208,21 +230,23 @@ bool save_basis_table(FILE *f) {
 //    static vector<BT_rec> Basis_table;
 //    static vector<pair<Basis, Basis> > Deg_to_basis_table; // maps degree to first and last indices in Basis_table associated with that degree
 
+    const BasisTableState &bt = CurrentSession().basis;
+
     {
-        int n = Basis_table.size();
+        int n = bt.Basis_table.size();
         fwrite(&n, sizeof(n), 1, f);
         for(int i=0; i<n; i++) {
-            auto a = Basis_table[i];
+            auto a = bt.Basis_table[i];
             fwrite(&a, sizeof(a), 1, f);
         }
     }
 
     {
-        int n = Deg_to_basis_table.size();
+        int n = bt.Deg_to_basis_table.size();
         fwrite(&n, sizeof(n), 1, f);
         for(int i=0; i<n; i++) {
-            auto a = Deg_to_basis_table[i].first;
-            auto b = Deg_to_basis_table[i].second;
+            auto a = bt.Deg_to_basis_table[i].first;
+            auto b = bt.Deg_to_basis_table[i].second;
             fwrite(&a, sizeof(a), 1, f);
             fwrite(&b, sizeof(b), 1, f);
         }
@@ -232,26 +256,27 @@ bool save_basis_table(FILE *f) {
 }
 
 bool restore_basis_table(FILE *f) {
-    Basis_table.clear();
+    BasisTableState &bt = CurrentSession().basis;
+    bt.Basis_table.clear();
     {
         int n = 0;
         if(fread(&n, sizeof(n), 1, f) != 1) return false;
-        Basis_table.resize(n);
+        bt.Basis_table.resize(n);
         for(int i=0; i<n; i++) {
-            if(fread(&Basis_table[i], sizeof(Basis_table[i]), 1, f) != 1) return false;
+            if(fread(&bt.Basis_table[i], sizeof(bt.Basis_table[i]), 1, f) != 1) return false;
         }
     }
 
-    Deg_to_basis_table.clear();
+    bt.Deg_to_basis_table.clear();
     {
         int n = 0;
         if(fread(&n, sizeof(n), 1, f) != 1) return false;
-        Deg_to_basis_table.resize(n);
+        bt.Deg_to_basis_table.resize(n);
         for(int i=0; i<n; i++) {
             Basis a, b;
             if(fread(&a, sizeof(a), 1, f) != 1) return false;
             if(fread(&b, sizeof(b), 1, f) != 1) return false;
-            Deg_to_basis_table[i] = make_pair(a, b);
+            bt.Deg_to_basis_table[i] = make_pair(a, b);
         }
     }
 
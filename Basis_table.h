@@ -19,6 +19,8 @@ Basis GetNextBasisTobeFilled();
 Basis BasisStart(Degree Deg);
 Basis BasisEnd(Degree Deg);
 Name GetType(Basis B);
+Basis LeftFactor(Basis B);
+Basis RightFactor(Basis B);
 void PrintBasisTable(FILE *filePtr);
 
 bool save_basis_table(FILE *f);
@@ -15,22 +15,32 @@
 /***      int DestroyStructures()                               ***/
 /***      int PrintProgress()                                   ***/
 /***      int ProcessDegree()                                   ***/
+/***      int ProcessTypesConcurrently()                        ***/
+/***      int ProcessLargeTypes()                               ***/
 /***      int ProcessType()                                     ***/
-/***      int SolveEquations()                                  ***/
+/***      int ReduceTypeMatrix()                                ***/
+/***      int ExtractTypeMatrix()                               ***/
 /***  MODULE DESCRIPTION:                                       ***/
 /***      Implement the Build Command.                          ***/
 /***      Reads the sparse global variable to determine         ***/
 /***      whether the traditional or sparse code should be used ***/
-/***      in the SolveEquations routine.                        ***/
+/***      in the ReduceTypeMatrix routine.                      ***/
 /******************************************************************/
 
+#include <algorithm>
+#include <condition_variable>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 using std::list;
 using std::vector;
 using std::pair;
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -41,6 +51,7 @@ using std::pair;
 #include "ExtractMatrix.h"
 #include "GenerateEquations.h"
 #include "Mult_table.h"
+#include "Session.h"
 #include "CreateMatrix.h"
 #include "Po_parse_exptext.h"
 #include "Id_routines.h"
@@ -52,6 +63,14 @@ using std::pair;
 #include "matrix_reduce.h"
 #include "matrix_reduce_avx.h"
 #include "matrix_reduce_float.h"
+#include "matrix_reduce_sge.h"
+#include "matrix_reduce_fl.h"
+#include "matrix_reduce_wiedemann.h"
+#include "matrix_components.h"
+#include "matrix_colorder.h"
+#include "matrix_online.h"
+#include "Type_orbits.h"
+#include "CreateSubs.h"
 #include "Debug.h"
 #include "memory_usage.h"
 
@@ -67,14 +86,75 @@ static int ProcessDegree(int i, const list<id_queue_node> &First_id_node);
 
 static void InstallDegree1();
 
-static int ProcessType(Name n, const list<id_queue_node> &First_id_node, SparseMatrix &SM);
+/* The equations of a type as a matrix, from their generation until the new basis elements and
+   products are extracted from it. */
+struct TypeMatrix {
+    TypeMatrix() : n(0), SM(), cols(0), BPtoCol(), PermutedBPtoCol(), rank(0), nodes(0), reduced(false), permuted(false),
+                   relabel(false), r(0), sigma(), status(OK), defer_messages(false), messages() {}
 
-static int SolveEquations(SparseMatrix &SM, int cols, vector<Unique_basis_pair> &BPtoCol, Name n);
+    Name n;
+    SparseMatrix SM;
+    int cols;
+    vector<Unique_basis_pair> BPtoCol;
+    vector<Unique_basis_pair> PermutedBPtoCol;
+    int rank;
+    long nodes;
+    bool reduced;           /* SM is in row canonical form */
+    bool permuted;          /* The columns of SM are in the order of PermutedBPtoCol */
+    bool relabel;           /* To be built from type r, mapped to n by sigma */
+    Name r;
+    vector<int> sigma;
+    int status;
+    bool defer_messages;    /* Progress messages are kept in messages, to be printed later */
+    std::string messages;
+};
+
+static void TypeMessage(TypeMatrix &tm, const char *format, ...);
+
+static void PrintMemoStats(TypeMatrix &tm, const GenerationStats &stats);
+
+static int ProcessTypesConcurrently(int i, const list<id_queue_node> &First_id_node);
+
+static int ProcessLargeTypes(int i, int first, int nn2, const vector<int> &large, vector<TypeMatrix> &batch,
+                             const list<id_queue_node> &First_id_node);
+
+static void FinishType(Name n, Basis begin_basis);
+
+static int ProcessType(Name n, const list<id_queue_node> &First_id_node, TypeMatrix &tm);
+
+static int PrepareType(Name n, const list<id_queue_node> &First_id_node, TypeMatrix &tm);
+
+static bool FindRelabeling(Name n, TypeMatrix &tm);
+
+static int GenerateType(const list<id_queue_node> &First_id_node, TypeMatrix &tm);
+
+static int RelabelTypeMatrix(const list<id_queue_node> &First_id_node, TypeMatrix &tm);
+
+static int GenerateTypeMatrix(const list<id_queue_node> &First_id_node, TypeMatrix &tm);
+
+static int GenerateTypeMatrixStreamed(const list<id_queue_node> &First_id_node, TypeMatrix &tm);
+
+static int ReduceTypeMatrix(TypeMatrix &tm, bool concurrent);
+
+static int ExtractTypeMatrix(TypeMatrix &tm);
+
+static int ReduceTheMatrix(SparseMatrix &SM, int cols, int *Rank);
 
 extern int sigIntFlag;        /* TW 10/8/93 - flag for Ctrl-C */
 
-static time_t Start_time;
-static Basis Current_dimension;
+/* With ALBERT_STREAM set, the equations of each type are reduced in chunks of this many as they are
+   generated. */
+static const int Stream_chunk = 4096;
+
+/* The types of a degree are processed in batches of up to this many basis pairs. The types of a batch
+   with at most Small_type_pairs pairs are generated concurrently, and reduced concurrently if their
+   matrices have at most Small_type_cells entries. The others are generated in a background thread, at
+   most one ahead of the one reduced with all threads, so that at most two large matrices are held. The new basis elements are then extracted in the order of the types, so they are
+   numbered as when each type is processed in turn. */
+static bool Parallel_types = true;
+static long Parallel_types_max_pairs = 1L << 22;
+static long Small_type_pairs = 1L << 16;
+static long Small_type_cells = 1L << 22;
 
 /*******************************************************************/
 /* MODIFIES:                                                       */
@@ -91,23 +171,30 @@ static Basis Current_dimension;
 /*     entered.                                                    */
 /*******************************************************************/
 
-// Variables controlling saving images of the matrix as it's reduced.
+// Variables controlling saving images of the matrix as it's reduced, kept by the thread that reduces it.
 bool __trigger = false;
-bool __record = false;
-int __deg = 0;
-int __nn1 = 0;
-int __nn2 = 0;
-
-int Build(list<id_queue_node> &Idq_node, Type Target_type) {
+thread_local bool __record = false;
+thread_local int __deg = 0;
+thread_local int __nn1 = 0;
+thread_local int __nn2 = 0;
+
+int Build(Session &session, list<id_queue_node> &Idq_node, Type Target_type) {
+    SessionScope scope(session);
+    BuildState &bs = session.build;
     int status = OK;
 
-    Start_time = time(nullptr);
-    const char *convtime = ctime(&Start_time);
+    bs.Start_time = time(nullptr);
+    const char *convtime = ctime(&bs.Start_time);
     printf("\nBuild begun at %s\n", convtime);
     printf("Degree    Current Dimension   Elapsed Time(in seconds) \n");
 
     status = InitializeStructures(Target_type);
 
+    /* With ALBERT_ORBITS set, a type mapped from one already solved by exchanging generators of the same
+       degree in the target is built from that type's products instead of from its own equations. The
+       algebra is the same, but the basis chosen may differ from the one solving the type would give. */
+    bs.Orbits.reset(getenv("ALBERT_ORBITS") ? new TypeOrbits(Target_type) : nullptr);
+
     int Target_degree = GetDegreeName(TypeToName(Target_type));
     if (status == OK) {
         for (int i = 1; i <= Target_degree; i++) {
@@ -155,7 +242,6 @@ int Build(list<id_queue_node> &Idq_node, Type Target_type) {
 
 /*******************************************************************/
 /* GLOBALS INITIALIZED:                                            */
-/*      Scalar Inverse_table -- For Scalar Arithemetic.            */
 /*      Mult_table -- Multiplication Table.                        */
 /*      Type_table -- Type Table for the Given Target Type.        */
 /*      Basis_table -- to 0's.                                     */
@@ -174,13 +260,14 @@ int InitializeStructures(Type Target_type) {
 
 
 long ElapsedTime() {
-    return time(nullptr) - Start_time;
+    return time(nullptr) - CurrentSession().build.Start_time;
 }
 
 void PrintProgress(int i, int n) {
+    BuildState &bs = CurrentSession().build;
     printf("  %2d/%2d           %4d            %5ld\n",
            i, n,
-           Current_dimension,
+           bs.Current_dimension,
            ElapsedTime());
 }
 
@@ -192,15 +279,16 @@ void PrintProgress(int i, int n) {
 /*     Process all Types of degree i.                              */
 /*******************************************************************/
 int ProcessDegree(int i, const list<id_queue_node> &First_id_node) {
+    BuildState &bs = CurrentSession().build;
     Name n;
     int status = OK;
     Basis begin_basis;
-    Basis end_basis = 0;
-
-    SparseMatrix SM;
 
     if (i == 1) {
         InstallDegree1();
+    } else if (Parallel_types) {
+        status = ProcessTypesConcurrently(i, First_id_node);
+        bs.Current_dimension = GetNextBasisTobeFilled() - 1;
     } else {
         int nn1 = 0;
         int nn2 = 0;
@@ -223,24 +311,240 @@ int ProcessDegree(int i, const list<id_queue_node> &First_id_node) {
             __nn2 = nn2;
             __record = __record && __nn1 == 1;
 
-            status = ProcessType(n, First_id_node, SM);
+            TypeMatrix tm;
+            status = ProcessType(n, First_id_node, tm);
             if (sigIntFlag == 1) {    /* TW 10/5/93 - Ctrl-C check */
 /*	     printf("Returning from ProcessDegree().\n");*/
                 return -1;
             }
-            end_basis = GetNextBasisTobeFilled() - 1;
-            if (end_basis < begin_basis) {
-                UpdateTypeTable(n, 0, 0);    /* No Basis table entries. */
+            FinishType(n, begin_basis);
+            n = NextTypeSameDegree(n);
+        }
+        bs.Current_dimension = GetNextBasisTobeFilled() - 1;
+    }
+    return status;
+}
+
+
+/*******************************************************************/
+/* REQUIRES:                                                       */
+/*     i -- to process degree i.                                   */
+/* FUNCTION:                                                       */
+/*     As ProcessDegree(), but the matrices of a batch of types    */
+/*     are generated and reduced concurrently, each type with its  */
+/*     own GenerationContext, in decreasing order of its number of */
+/*     basis pairs. Large types are generated in the background    */
+/*     while the one before is reduced with all threads. The new   */
+/*     basis is extracted afterwards, in the order of the types.   */
+/*     Relabeled types are built while extracting, once the type   */
+/*     they come from is complete.                                 */
+/*******************************************************************/
+int ProcessTypesConcurrently(int i, const list<id_queue_node> &First_id_node) {
+    int status = OK;
+
+    vector<Name> names;
+    vector<long> pairs;
+    for (Name n = FirstTypeDegree(i); n != -1; n = NextTypeSameDegree(n)) {
+        names.push_back(n);
+        pairs.push_back(CountPairUniverse(n));
+    }
+    const int nn2 = names.size();
+
+    int first = 0;
+    while (status == OK && first < nn2) {
+        int last = first;
+        long batch_pairs = 0;
+        for (; last < nn2 && (last == first || batch_pairs + pairs[last] <= Parallel_types_max_pairs); last++) {
+            batch_pairs += pairs[last];
+        }
+        vector<TypeMatrix> batch(last - first);
+
+        /* The types of the orbit of one already seen are only marked, to be relabeled. */
+        vector<int> small;
+        vector<int> large;
+        for (int k = 0; k < (int) batch.size(); k++) {
+            TypeMatrix &tm = batch[k];
+            tm.defer_messages = true;
+            TypeMessage(tm, "\tPreparing(%2d/%2d)...", first + k + 1, nn2);
+            if (FindRelabeling(names[first + k], tm)) {
+                TypeMessage(tm, "\n");
+            } else if (pairs[first + k] <= Small_type_pairs) {
+                small.push_back(k);
             } else {
-                UpdateTypeTable(n, begin_basis, end_basis);
+                large.push_back(k);
             }
-            n = NextTypeSameDegree(n);
         }
-        Current_dimension = end_basis;
+        auto by_pairs = [&pairs, first](int a, int b) { return pairs[first + a] > pairs[first + b]; };
+        std::stable_sort(small.begin(), small.end(), by_pairs);
+        std::stable_sort(large.begin(), large.end(), by_pairs);
+
+        /* Each small type is generated, and reduced, by one thread. Methods chosen with ALBERT_METHODS are
+           only run by ReduceTheMatrix(), so the matrices are then all reduced below. */
+        if (!small.empty()) {
+            const bool reduce_small = !getenv("ALBERT_METHODS");
+            printf("\tGenerating %d types concurrently...", (int) small.size());
+            fflush(nullptr);
+#pragma omp parallel for schedule(dynamic, 1) shared(batch, small, First_id_node, Small_type_cells, reduce_small) default(none) copyin(Current_session, Current_field)
+            for (int k = 0; k < (int) small.size(); k++) {
+                TypeMatrix &tm = batch[small[k]];
+                tm.status = GenerateType(First_id_node, tm);
+                if (reduce_small && tm.status == OK && !tm.reduced &&
+                    (long) tm.SM.size() * (long) tm.cols <= Small_type_cells) {
+                    tm.status = ReduceTypeMatrix(tm, true);
+                }
+            }
+            printf("(%lds)\n", ElapsedTime());
+        }
+
+        if (!large.empty()) {
+            status = ProcessLargeTypes(i, first, nn2, large, batch, First_id_node);
+        }
+        if (sigIntFlag == 1) {
+            return -1;
+        }
+        if (status != OK) break;
+
+        for (int k = 0; k < (int) batch.size(); k++) {
+            TypeMatrix &tm = batch[k];
+            fputs(tm.messages.c_str(), stdout);
+            std::string().swap(tm.messages);
+            tm.defer_messages = false;
+            if (status == OK) status = tm.status;
+        }
+        fflush(nullptr);
+
+        if (sigIntFlag == 1) {
+            return -1;
+        }
+        if (status != OK) break;
+
+        /* The matrices left are reduced one at a time with all threads. */
+        for (int k = 0; k < (int) batch.size() && status == OK; k++) {
+            TypeMatrix &tm = batch[k];
+            if (tm.reduced || tm.relabel) continue;
+
+            __deg = i - 1;
+            __nn1 = first + k + 1;
+            __nn2 = nn2;
+            __record = __record && __nn1 == 1;
+
+            printf("\tReducing(%2d/%2d)...\n", first + k + 1, nn2);
+            fflush(nullptr);
+            status = tm.status = ReduceTypeMatrix(tm, false);
+        }
+
+        for (int k = 0; k < (int) batch.size() && status == OK; k++) {
+            TypeMatrix &tm = batch[k];
+
+            Basis begin_basis = GetNextBasisTobeFilled();
+            printf("\tProcessing(%2d/%2d, begin_basis:%d)...", first + k + 1, nn2, begin_basis);
+            fflush(nullptr);
+
+            status = tm.status;
+            if (status == OK && tm.relabel) {
+                status = RelabelTypeMatrix(First_id_node, tm);
+                if (status == OK && !tm.reduced) status = ReduceTypeMatrix(tm, false);
+            }
+            if (status == OK) {
+                status = ExtractTypeMatrix(tm);
+                printf("\t\tDone: %lds\n", ElapsedTime());
+            }
+            if (sigIntFlag == 1) {
+                return -1;
+            }
+            FinishType(tm.n, begin_basis);
+            SparseMatrix().swap(tm.SM);
+        }
+
+        first = last;
     }
+
     return status;
 }
 
+/*******************************************************************/
+/* REQUIRES:                                                       */
+/*     large -- the types of batch, from the type first + 1 of     */
+/*              degree i, too large to be generated by one thread. */
+/* FUNCTION:                                                       */
+/*     Generate the matrices of the large types in a background    */
+/*     thread, each while the one before it is reduced with all    */
+/*     threads. At most one matrix waits to be taken, so no more   */
+/*     than two large matrices are held at once. Their progress    */
+/*     messages are kept until they are taken.                     */
+/*******************************************************************/
+int ProcessLargeTypes(int i, int first, int nn2, const vector<int> &large, vector<TypeMatrix> &batch,
+                      const list<id_queue_node> &First_id_node) {
+    std::mutex m;
+    std::condition_variable cv;
+    int produced = 0;
+    int taken = 0;
+    bool stop = false;
+
+    Session &session = CurrentSession();
+    std::thread producer([&]() {
+        SessionScope scope(session);
+        for (int k : large) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&]() { return taken == produced || stop; });
+                if (stop) break;
+            }
+
+            batch[k].status = GenerateType(First_id_node, batch[k]);
+
+            std::lock_guard<std::mutex> lock(m);
+            produced++;
+            cv.notify_all();
+        }
+    });
+
+    int status = OK;
+    for (int k : large) {
+        {
+            std::unique_lock<std::mutex> lock(m);
+            cv.wait(lock, [&]() { return taken < produced; });
+        }
+
+        TypeMatrix &tm = batch[k];
+        fputs(tm.messages.c_str(), stdout);
+        std::string().swap(tm.messages);
+        tm.defer_messages = false;
+        status = tm.status;
+
+        if (status == OK && sigIntFlag != 1 && !tm.reduced) {
+            __deg = i - 1;
+            __nn1 = first + k + 1;
+            __nn2 = nn2;
+            __record = __record && __nn1 == 1;
+
+            printf("\tReducing(%2d/%2d)...\n", first + k + 1, nn2);
+            fflush(nullptr);
+            status = tm.status = ReduceTypeMatrix(tm, false);
+        }
+
+        std::lock_guard<std::mutex> lock(m);
+        taken++;
+        stop = status != OK || sigIntFlag == 1;
+        cv.notify_all();
+        if (stop) break;
+    }
+    producer.join();
+
+    return status;
+}
+
+
+/* Record the basis elements entered for type n, from begin_basis on, in the type table. */
+void FinishType(Name n, Basis begin_basis) {
+    Basis end_basis = GetNextBasisTobeFilled() - 1;
+    if (end_basis < begin_basis) {
+        UpdateTypeTable(n, 0, 0);    /* No Basis table entries. */
+    } else {
+        UpdateTypeTable(n, begin_basis, end_basis);
+    }
+}
+
 
 /*******************************************************************/
 /* REQUIRES: None.                                                 */
@@ -249,6 +553,7 @@ int ProcessDegree(int i, const list<id_queue_node> &First_id_node) {
 /*     Table.                                                      */
 /*******************************************************************/
 void InstallDegree1() {
+    BuildState &bs = CurrentSession().build;
     Basis end_basis = 0;
 
     Type temp_type = GetNewType();
@@ -266,7 +571,7 @@ void InstallDegree1() {
         end_basis = GetNextBasisTobeFilled() - 1;
         UpdateTypeTable(n, begin_basis, end_basis);
     }
-    Current_dimension = end_basis;
+    bs.Current_dimension = end_basis;
 
     free(temp_type);
 }
@@ -282,25 +587,157 @@ void InstallDegree1() {
 /*     other basis pairs in terms of existing basis.               */
 /*******************************************************************/
 /* Process type t for degree i */
-int ProcessType(Name n, const list<id_queue_node> &First_id_node, SparseMatrix &SM) {
-    int cols = 0;
-    vector<Unique_basis_pair> BPtoCol;
+int ProcessType(Name n, const list<id_queue_node> &First_id_node, TypeMatrix &tm) {
+    int status = PrepareType(n, First_id_node, tm);
 
-    SM.clear();
+    if (status == OK && !tm.reduced) {
+        status = ReduceTypeMatrix(tm, false);
+    }
+
+    if (status == OK) {
+        status = ExtractTypeMatrix(tm);
+        printf("\t\tDone: %lds\n", ElapsedTime());
+    }
+
+    return status;
+}
+
+/*******************************************************************/
+/* REQUIRES:                                                       */
+/*     t -- to process Type t.                                     */
+/* FUNCTION:                                                       */
+/*     Build the matrix of type t, from its equations or by        */
+/*     relabeling a type of its orbit.                             */
+/*******************************************************************/
+int PrepareType(Name n, const list<id_queue_node> &First_id_node, TypeMatrix &tm) {
+    if (FindRelabeling(n, tm)) {
+        return RelabelTypeMatrix(First_id_node, tm);
+    }
+
+    return GenerateType(First_id_node, tm);
+}
+
+/*******************************************************************/
+/* REQUIRES:                                                       */
+/*     n -- the type of tm, processed in the order of the types.   */
+/* RETURNS:                                                        */
+/*     Whether a type of its orbit was seen before, tm then being  */
+/*     marked to be relabeled from it.                             */
+/*******************************************************************/
+bool FindRelabeling(Name n, TypeMatrix &tm) {
+    BuildState &bs = CurrentSession().build;
+    tm.n = n;
+
+    if (bs.Orbits && bs.Orbits->find(n, &tm.r, tm.sigma)) {
+        tm.relabel = true;
+    }
+
+    return tm.relabel;
+}
+
+/*******************************************************************/
+/* REQUIRES:                                                       */
+/*     tm -- the type, from FindRelabeling(), to generate.         */
+/* FUNCTION:                                                       */
+/*     Generate the matrix of the equations of the type. Types     */
+/*     may be generated concurrently.                              */
+/*******************************************************************/
+int GenerateType(const list<id_queue_node> &First_id_node, TypeMatrix &tm) {
+    if (getenv("ALBERT_STREAM")) {
+        return GenerateTypeMatrixStreamed(First_id_node, tm);
+    }
+
+    return GenerateTypeMatrix(First_id_node, tm);
+}
+
+/* Print a progress message of a type, or keep it with the type while types are generated concurrently. */
+void TypeMessage(TypeMatrix &tm, const char *format, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(buf, sizeof(buf), format, ap);
+    va_end(ap);
+
+    if (tm.defer_messages) {
+        tm.messages += buf;
+    } else {
+        fputs(buf, stdout);
+        fflush(nullptr);
+    }
+}
+
+/* The share of the subword products of the substitutions found in the memo. */
+void PrintMemoStats(TypeMatrix &tm, const GenerationStats &stats) {
+    if (stats.memo_lookups > 0) {
+        TypeMessage(tm, "memo:%.1f%%...", 100. * stats.memo_hits / stats.memo_lookups);
+    }
+}
+
+static void PrintTypeMatrix(TypeMatrix &tm) {
+    tm.nodes = 0;
+    for (const auto &row : tm.SM) {
+        tm.nodes += row.size();
+    }
+
+    /* Rows of a matrix already in row canonical form are empty after the rank. */
+    if (tm.reduced) {
+        tm.rank = 0;
+        while (tm.rank < (int) tm.SM.size() && !tm.SM[tm.rank].empty()) tm.rank++;
+    }
+
+    TypeMessage(tm, "Matrix:(%d X %d)\n", (int) tm.SM.size(), tm.cols);
+}
+
+/*******************************************************************/
+/* REQUIRES:                                                       */
+/*     tm -- a type marked to be relabeled.                        */
+/* FUNCTION:                                                       */
+/*     Build the relations of the type in row canonical form from  */
+/*     the type it is mapped from, falling back to generating its  */
+/*     equations.                                                  */
+/*******************************************************************/
+int RelabelTypeMatrix(const list<id_queue_node> &First_id_node, TypeMatrix &tm) {
+    if (CurrentSession().build.Orbits->relabels(tm.r)) {
+        TypeMessage(tm, "Relabeling...");
+
+        if (RelabelType(tm.n, tm.r, tm.sigma, tm.SM, &tm.cols, tm.BPtoCol) == OK) {
+            tm.reduced = true;
+            TypeMessage(tm, "(%lds)...Solving...", ElapsedTime());
+            PrintTypeMatrix(tm);
+            return OK;
+        }
+    }
+
+    tm.relabel = false;
+    return GenerateTypeMatrix(First_id_node, tm);
+}
+
+/*******************************************************************/
+/* REQUIRES:                                                       */
+/*     tm -- the type to generate the equations of.                */
+/* FUNCTION:                                                       */
+/*     For each identity f, whose degree is less than the degree   */
+/*     of the type, generate equations corresponding to f, and     */
+/*     convert them to a matrix.                                   */
+/*******************************************************************/
+int GenerateTypeMatrix(const list<id_queue_node> &First_id_node, TypeMatrix &tm) {
+    const Name n = tm.n;
+
+    tm.SM.clear();
 
     int status = OK;
     {
         Equations equations;
+        GenerationStats stats;
 
-        printf("Generating...");
-        fflush(nullptr);
+        TypeMessage(tm, "Generating...");
 
         list<id_queue_node>::const_iterator ii = First_id_node.begin();
         for (; ii != First_id_node.end() && status == OK; ii++) {
             const polynomial *f = ii->identity;
 
             if (f->degree <= GetDegreeName(n)) {
-                status = GenerateEquations(f, n, equations);
+                status = GenerateEquations(f, n, equations, nullptr, 0, &stats);
             }
 
             if (sigIntFlag == 1) {        /* TW 10/5/93 - Ctrl-C check */
@@ -315,69 +752,254 @@ int ProcessType(Name n, const list<id_queue_node> &First_id_node, SparseMatrix &
                 for (int i = 0; i < (int) equations.size(); i++) {
                     tt += equations[i].size();
                 }
-                printf("neqn:%d (ne:%d MB:%.2f)...",
-                       (int) equations.size(), tt,
-                       tt * sizeof(Basis_pair) / 1024. / 1024.);
-                fflush(nullptr);
+                TypeMessage(tm, "neqn:%d (ne:%d MB:%.2f)...",
+                            (int) equations.size(), tt,
+                            tt * sizeof(Basis_pair) / 1024. / 1024.);
             }
 #endif
+            PrintMemoStats(tm, stats);
 
 #if DEBUG_EQNS
             PrintEqns(equations);
 #endif
 
-            printf("(%lds)...Solving...", ElapsedTime());
-            fflush(nullptr);
-            status = SparseCreateTheMatrix(equations, SM, &cols, BPtoCol, n);
+            TypeMessage(tm, "(%lds)...Solving...", ElapsedTime());
+            int duplicates = 0;
+            status = SparseCreateTheMatrix(equations, tm.SM, &tm.cols, tm.BPtoCol, n, &duplicates);
+            TypeMessage(tm, "Duplicates:%d...", duplicates);
 
             //printf("BPtoCol:(%d MB:%.2f)...", (int)BPtoCol.size(), BPtoCol.size()*sizeof(Unique_basis_pair)/1024./1024.);
         }
     }
 
     if (status == OK) { /*SM.shrink_to_fit();*/
-        status = SolveEquations(SM, cols, BPtoCol, n);
-        printf("\t\tDone: %lds\n", ElapsedTime());
+        PrintTypeMatrix(tm);
     }
 
     return status;
 }
 
+/* Equations are converted to rows and folded into an online echelon form as they are generated. */
+class StreamedEquations : public EquationSink {
+public:
+    StreamedEquations(Name n, const vector<Unique_basis_pair> &Universe_)
+            : Universe(Universe_), Columns(GetDegreeName(n), Universe_), used(Universe_.size(), false),
+              echelon(Universe_.size()), neqn(0), ndup(0) {}
+
+    void consume(Equations &equations) override {
+        SparseMatrix rows;
+        int duplicates = 0;
+        SparseAppendEquations(equations, Columns, rows, used, &duplicates);
+        neqn += equations.size();
+        ndup += duplicates;
+        Equations().swap(equations);
+        for (auto &row : rows) {
+            echelon.insert(row);
+        }
+    }
+
+    bool saturated() const override {
+        return echelon.rank() == (int) Universe.size();
+    }
+
+    const vector<Unique_basis_pair> &Universe;
+    ColumnIndex Columns;
+    vector<char> used;
+    OnlineEchelon echelon;
+    long neqn;
+    long ndup;
+};
+
 /*******************************************************************/
 /* REQUIRES:                                                       */
-/*     L -- Head to List of Equations.                             */
-/*     t -- Current Type being processed.                          */
+/*     t -- to process Type t.                                     */
 /* FUNCTION:                                                       */
-/*     Convert the given list of equations into Matrix, i.e one    */
-/*     row for each equation and one column for each unique basis  */
-/*     pair present in all equations.                              */
-/*     Then Reduce that Matrix into row canonical form.            */
-/*     Then Extract from the Reduced Matrix i.e Find New Basis     */
-/*     and enter them into Basis Table. Then write Dependent Basis */
-/*     pairs into Basis by entering products into Mult_table.      */
+/*     As GenerateTypeMatrix(), but the equations are reduced in   */
+/*     chunks as they are generated, and freed, so only the        */
+/*     reduced rows are kept. The columns are all basis pairs of   */
+/*     the type, and are compacted to those present in the         */
+/*     equations after.                                            */
+/*******************************************************************/
+int GenerateTypeMatrixStreamed(const list<id_queue_node> &First_id_node, TypeMatrix &tm) {
+    const Name n = tm.n;
+    SparseMatrix &SM = tm.SM;
+    vector<Unique_basis_pair> &BPtoCol = tm.BPtoCol;
+
+    SM.clear();
+
+    vector<Unique_basis_pair> Universe;
+    CreatePairUniverse(n, Universe);
+
+    int status = OK;
+    {
+        StreamedEquations streamed(n, Universe);
+        Equations equations;
+        GenerationStats stats;
+
+        TypeMessage(tm, "Generating and reducing...");
+
+        /* Once the rows have full rank on all basis pairs of the type, any further equations are implied. */
+        list<id_queue_node>::const_iterator ii = First_id_node.begin();
+        for (; ii != First_id_node.end() && status == OK && !streamed.saturated(); ii++) {
+            const polynomial *f = ii->identity;
+
+            if (f->degree <= GetDegreeName(n)) {
+                status = GenerateEquations(f, n, equations, &streamed, Stream_chunk, &stats);
+                streamed.consume(equations);
+            }
+
+            if (sigIntFlag == 1) {
+                return -1;
+            }
+        }
+
+        if (status == OK) {
+            PrintMemoStats(tm, stats);
+            TypeMessage(tm, "neqn:%ld dup:%ld rank:%d%s...(%lds)...Solving...", streamed.neqn, streamed.ndup,
+                        streamed.echelon.rank(), streamed.saturated() ? " (saturated)" : "", ElapsedTime());
+
+            streamed.echelon.finish(SM);
+
+            /* Compact the columns to the pairs present in the equations, keeping their order. */
+            vector<int> col_map(Universe.size(), -1);
+            for (int c = 0; c < (int) Universe.size(); c++) {
+                if (streamed.used[c]) {
+                    col_map[c] = BPtoCol.size();
+                    BPtoCol.push_back(Universe[c]);
+                }
+            }
+            tm.cols = BPtoCol.size();
+            for (auto &row : SM) {
+                for (auto &node : row) node.setColumn(col_map[node.getColumn()]);
+            }
+        }
+    }
+
+    if (status == OK) {
+        tm.reduced = true;
+        PrintTypeMatrix(tm);
+    }
+
+    return status;
+}
+
 /*******************************************************************/
-int SolveEquations(SparseMatrix &SM, int cols, vector<Unique_basis_pair> &BPtoCol, Name n) {
+/* REQUIRES:                                                       */
+/*     tm -- the matrix of the type being processed.               */
+/* FUNCTION:                                                       */
+/*     Reduce the Matrix into row canonical form. Concurrent       */
+/*     reductions of several types use the sparse reduction alone, */
+/*     without output.                                             */
+/*******************************************************************/
+int ReduceTypeMatrix(TypeMatrix &tm, bool concurrent) {
+    SparseMatrix &SM = tm.SM;
+    const int cols = tm.cols;
+
 #if DEBUG_MATRIX
     PrintColtoBP();
     PrintTheMatrix();
 #endif
 
-    int tt = 0;
+    /* Experimental: optionally reorder the columns to reduce fill. The reduced matrix then has
+       pivots, and so new basis elements, chosen in the new column order. The choice still only
+       depends on the matrix, so it is deterministic, but the basis differs from that of a normal
+       build. It has not been found to pay off: on medium.in it ends with more fill, and the
+       multiplication table is twice as long. */
+    if (getenv("ALBERT_COLORDER")) {
+        vector<int> new_of_old;
+        FillReducingColumnOrder(SM, cols, new_of_old);
+        PermuteColumns(SM, new_of_old);
+        tm.PermutedBPtoCol.resize(cols);
+        for (int c = 0; c < cols; c++) {
+            tm.PermutedBPtoCol[new_of_old[c]] = tm.BPtoCol[c];
+        }
+        tm.permuted = true;
+    }
+
+    int status;
+    if (concurrent) {
+        status = MatrixReduceSGE::reduce(SM, cols, &tm.rank, -1, false);
+    } else {
+        status = ReduceTheMatrix(SM, cols, &tm.rank);
+    }
+    tm.reduced = true;
+
+    return status;
+}
+
+/*******************************************************************/
+/* REQUIRES:                                                       */
+/*     tm -- the reduced matrix of the type being processed.       */
+/* FUNCTION:                                                       */
+/*     Extract from the Reduced Matrix i.e Find New Basis          */
+/*     and enter them into Basis Table. Then write Dependent Basis */
+/*     pairs into Basis by entering products into Mult_table.      */
+/*******************************************************************/
+int ExtractTypeMatrix(TypeMatrix &tm) {
+    const SparseMatrix &SM = tm.SM;
+    const int cols = tm.cols;
+
+    long tt = 0;
     for (int i = 0; i < (int) SM.size(); i++) {
         tt += SM[i].size();
     }
-    int p_tt = tt;
+    if (SM.size() * cols > 0) {
+        printf("\t\tFill: (%.1f%% %.1fMB)->",
+               tm.nodes / double(SM.size() * cols) * 100.,
+               tm.nodes * sizeof(Node) / 1024. / 1024.);
+        printf("(%.1f%% %.1fMB)\n",
+               tt / double(SM.size() * cols) * 100.,
+               tt * sizeof(Node) / 1024. / 1024.);
+    }
+    fflush(nullptr);
+
+#if DEBUG_MATRIX
+    PrintTheRMatrix();
+#endif
+
+    /* A type may be the representative of its orbit, which can only be relabeled if each pair of its
+       equations is in some relation. */
+    BuildState &bs = CurrentSession().build;
+    if (bs.Orbits && !tm.relabel) {
+        vector<char> related(cols, false);
+        int n_related = 0;
+        for (int i = 0; i < tm.rank; i++) {
+            for (const auto &node : SM[i]) {
+                if (!related[node.getColumn()]) {
+                    related[node.getColumn()] = true;
+                    n_related++;
+                }
+            }
+        }
+        if (n_related < cols) bs.Orbits->note_unrelated_pairs(tm.n);
+    }
+
+/* ExtractMatrix will expand basis table & MultTable ! */
+    int status = SparseExtractFromMatrix(SM, cols, tm.rank, tm.n, tm.permuted ? tm.PermutedBPtoCol : tm.BPtoCol,
+                                         tm.BPtoCol);
+#if DEBUG_MATRIX
+    PrintDependent();
+#endif
 
-    int rank = 0;
+    return status;
+}
+
+/*******************************************************************/
+/* REQUIRES:                                                       */
+/*     SM -- Matrix of equations with cols columns.                */
+/* FUNCTION:                                                       */
+/*     Reduce SM to row canonical form, with the rank rows first.  */
+/*******************************************************************/
+int ReduceTheMatrix(SparseMatrix &SM, int cols, int *Rank) {
     int status = 0;
-    printf("Matrix:(%d X %d)\n", (int) SM.size(), cols);
 
 #if !TEST_SOLVERS
-    status = SparseReduceMatrix(SM, cols, &rank);
+    status = SparseReduceByComponents(SM, cols, Rank, SparseReduceMatrix);
 #else
     SparseMatrix saved_SM = SM;
 
     if (cols == 12 || 1) {
-        const int nfuncs = 8;
+        const int nfuncs = 12;
         int (*funcs[])(SparseMatrix &SM, int nCols, int *Rank) = {SparseReduceMatrix,
                                                                   SparseReduceMatrix2,
                                                                   SparseReduceMatrix3,
@@ -385,7 +1007,11 @@ int SolveEquations(SparseMatrix &SM, int cols, vector<Unique_basis_pair> &BPtoCo
                                                                   SparseReduceMatrix5,
                                                                   SparseReduceMatrix6,
                                                                   SparseReduceMatrix7,
-                                                                  SparseReduceMatrix8};
+                                                                  SparseReduceMatrix8,
+                                                                  SparseReduceMatrix9,
+                                                                  SparseReduceMatrix10,
+                                                                  SparseReduceMatrix11,
+                                                                  SparseReduceMatrix12};
         const char *func_names[] = {"original",
                                     "column-major",
                                     "lazy-evaluation",
@@ -393,7 +1019,11 @@ int SolveEquations(SparseMatrix &SM, int cols, vector<Unique_basis_pair> &BPtoCo
                                     "truncated-dense",
                                     "truncated-dense-avx-float",
                                     "precompute-division-cache",
-                                    "truncated-dense-avx"};
+                                    "truncated-dense-avx",
+                                    "truncated-dense-pluq",
+                                    "structured-gauss-avx",
+                                    "faugere-lachartre",
+                                    "wiedemann"};
         bool include[] = {false,
                           false,
                           false,
@@ -401,7 +1031,11 @@ int SolveEquations(SparseMatrix &SM, int cols, vector<Unique_basis_pair> &BPtoCo
                           false,
                           false,
                           false,
-                          true};
+                          false,
+                          false,
+                          true,
+                          false,
+                          false};
 
         if (getenv("ALBERT_METHODS")) {
             for (int i=0; i<sizeof(include); i++) {
@@ -431,10 +1065,10 @@ int SolveEquations(SparseMatrix &SM, int cols, vector<Unique_basis_pair> &BPtoCo
 
             int rank_ = 0;
             SparseMatrix SM_ = saved_SM;
-            int status_ = funcs[i](SM_, cols, &rank_);
+            int status_ = SparseReduceByComponents(SM_, cols, &rank_, funcs[i]);
 
             if (first_func == -1) {
-                rank = rank_;
+                *Rank = rank_;
                 status = status_;
                 SM = SM_;
                 first_func = i;
@@ -442,7 +1076,7 @@ int SolveEquations(SparseMatrix &SM, int cols, vector<Unique_basis_pair> &BPtoCo
                 if (status != status_) {
                     abort();
                 }
-                if (rank != rank_) {
+                if (*Rank != rank_) {
                     abort();
                 }
                 if (SM != SM_) {
@@ -466,31 +1100,5 @@ int SolveEquations(SparseMatrix &SM, int cols, vector<Unique_basis_pair> &BPtoCo
     }
 #endif
 
-    tt = 0;
-    for (int i = 0; i < (int) SM.size(); i++) {
-        tt += SM[i].size();
-    }
-    if (SM.size() * cols > 0) {
-        printf("\t\tFill: (%.1f%% %.1fMB)->",
-               p_tt / double(SM.size() * cols) * 100.,
-               p_tt * sizeof(Node) / 1024. / 1024.);
-        printf("(%.1f%% %.1fMB)\n",
-               tt / double(SM.size() * cols) * 100.,
-               tt * sizeof(Node) / 1024. / 1024.);
-    }
-    fflush(nullptr);
-
-#if DEBUG_MATRIX
-    PrintTheRMatrix();
-#endif
-
-/* ExtractMatrix will expand basis table & MultTable ! */
-    if (status == OK) {
-        status = SparseExtractFromMatrix(SM, cols, rank, n, BPtoCol);
-    }
-#if DEBUG_MATRIX
-    PrintDependent();
-#endif
-
     return status;
 }
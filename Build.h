@@ -4,8 +4,9 @@
 #include <list>
 
 #include "Id_routines.h"
+#include "Session.h"
 #include "Type_table.h"
 
-int Build(std::list<id_queue_node> &Idq_node, Type Ttype);
+int Build(Session &session, std::list<id_queue_node> &Idq_node, Type Ttype);
 
 #endif
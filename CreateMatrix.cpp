@@ -61,27 +61,21 @@ using std::vector;
 #include "SparseReduceMatrix.h"
 #include "Type_table.h"
 
-#include <set>
+#include <unordered_set>
 
-using std::set;
-using std::pair;
-using std::make_pair;
-
-static set<pair<int, int> > pp;
-
-inline int pp_contains(int r, int c) {
-    return pp.find(make_pair(r, c)) != pp.end();
-}
-
-static void FillPairPresent(const Equations &equations);
-
-static void CreateColtoBP(Name N, vector<Unique_basis_pair> &ColtoBP);
+static void FillPairPresent(const Equations &equations, ColumnIndex &Columns);
 
 static bool AreBasisElements(Degree d);
 
-static void Process(vector<Unique_basis_pair> &ColtoBP, Degree d1, Degree d2, int *col_to_bp_index_ptr);
+static int SparseFillTheMatrix(const Equations &equations, const ColumnIndex &Columns, SparseMatrix &SM,
+                               int *Duplicates);
+
+static int RemoveDuplicateRows(SparseMatrix &SM, int se);
 
-static int SparseFillTheMatrix(const Equations &equations, const vector<Unique_basis_pair> &ColtoBP, SparseMatrix &SM);
+/* Many substitutions give the same equation up to a scalar. When set, rows are scaled to a leading
+   coefficient of one as they are filled, and zero and repeated rows dropped before reduction. */
+static bool Remove_duplicate_rows = true;
+static const int Duplicate_shards = 64;
 
 #if 0
 static void PrintPairPresent();
@@ -95,15 +89,12 @@ static void PrintTheMatrix();
    before returning to SolveEquations() in Build.c */
 
 int SparseCreateTheMatrix(const Equations &equations, SparseMatrix &SM, int *Cols,
-                          vector<Unique_basis_pair> &ColtoBP, Name n) {
-    pp.clear();
-    ColtoBP.clear();
+                          vector<Unique_basis_pair> &ColtoBP, Name n, int *Duplicates) {
+    ColumnIndex Columns(GetDegreeName(n));
 
-    FillPairPresent(equations);
-/*
-    PrintPairPresent();
-*/
-    CreateColtoBP(n, ColtoBP);
+    FillPairPresent(equations, Columns);
+    Columns.finish();
+    Columns.pairs(ColtoBP);
 
 #if 0
     {
@@ -113,7 +104,7 @@ int SparseCreateTheMatrix(const Equations &equations, SparseMatrix &SM, int *Col
     }
 #endif
 
-    if (SparseFillTheMatrix(equations, ColtoBP, SM) != OK)
+    if (SparseFillTheMatrix(equations, Columns, SM, Duplicates) != OK)
         return 0;
 
 #if 0
@@ -130,43 +121,25 @@ int SparseCreateTheMatrix(const Equations &equations, SparseMatrix &SM, int *Col
     }
 #endif
 
-    *Cols = pp.size();
-
-    pp.clear();
+    *Cols = Columns.size();
 
     return OK;
 }
 
 
-void FillPairPresent(const Equations &equations) {
-    for (auto ii = equations.cbegin(); ii != equations.cend(); ii++) {
-        for (auto jj = ii->cbegin(); jj != ii->cend() /*&& (jj->coef != 0)*/; jj++) {
-            for (auto kk = jj->cbegin(); kk != jj->cend() /*&& (jj->coef != 0)*/; kk++) {
-                pp.insert(make_pair(kk->left_basis, kk->right_basis));
+/* The pairs are marked in the bitmap of Columns by several threads at once. */
+void FillPairPresent(const Equations &equations, ColumnIndex &Columns) {
+#pragma omp parallel for shared(equations, Columns) schedule(dynamic, 64) default(none)
+    for (int eq_number = 0; eq_number < (int) equations.size(); eq_number++) {
+        for (const auto &terms : equations[eq_number]) {
+            for (const auto &bp : terms) {
+                Columns.insert(bp.left_basis, bp.right_basis);
             }
         }
     }
 }
 
 
-void CreateColtoBP(Name N, vector<Unique_basis_pair> &ColtoBP) {
-    const int Num_unique_basis_pairs = pp.size();
-
-    if (Num_unique_basis_pairs > 0) {
-        ColtoBP.resize(Num_unique_basis_pairs);
-
-        const Degree d = GetDegreeName(N);
-        int col_to_bp_index = 0;
-
-        for (int i = 1; i < d; i++) {
-            /*  	This check added 5/94   (DPJ)    */
-            if (AreBasisElements(i) && AreBasisElements(d - i)) {
-                Process(ColtoBP, i, d - i, &col_to_bp_index);
-            }
-        }
-    }
-}
-
 /*
 5/94 (DPJ)
 Returns true if there are basis elements at degree d.
@@ -178,39 +151,24 @@ bool AreBasisElements(Degree d) {
 }
 
 
-void Process(vector<Unique_basis_pair> &ColtoBP, Degree d1, Degree d2, int *col_to_bp_index_ptr) {
-    const Basis b1 = BasisStart(d1);
-    const Basis b2 = BasisEnd(d1);
-    const Basis b3 = BasisStart(d2);
-    const Basis b4 = BasisEnd(d2);
-
-    for (Basis i = b1; i <= b2; i++) {
-        for (Basis j = b3; j <= b4; j++) {
-            if (pp_contains(i, j)) {
-                ColtoBP[*col_to_bp_index_ptr].left_basis = i;
-                ColtoBP[*col_to_bp_index_ptr].right_basis = j;
-                (*col_to_bp_index_ptr)++;
-            }
-        }
-    }
-}
-
+int SparseFillTheMatrix(const Equations &equations, const ColumnIndex &Columns, SparseMatrix &SM,
+                        int *Duplicates) {
+    *Duplicates = 0;
 
-int SparseFillTheMatrix(const Equations &equations, const vector<Unique_basis_pair> &ColtoBP, SparseMatrix &SM) {
-    if (ColtoBP.empty() || equations.empty())
+    if (Columns.size() == 0 || equations.empty())
         return OK;
 
     const int se = SM.size();
     SM.resize(se + equations.size());
 
-#pragma omp parallel for shared(equations, ColtoBP, SM, se), schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(equations, Columns, SM, se, Remove_duplicate_rows), schedule(dynamic, 10) default(none) copyin(Current_field)
     for (int eq_number = 0; eq_number < (int) equations.size(); eq_number++) {
         const Equation &eqn = equations[eq_number];
         SparseRow t_row;
 
         for (int i = 0; i < (int) eqn.size() /* && eqn[i].coef != 0*/; i++) {
             for (int j = 0; j < (int) eqn[i].size() /* && eqn[i].coef != 0*/; j++) {
-                const int col = GetCol(ColtoBP, eqn[i][j].left_basis, eqn[i][j].right_basis);
+                const int col = Columns.column(eqn[i][j].left_basis, eqn[i][j].right_basis);
                 const Scalar coef = eqn[i][j].coef;
 
                 SparseRow::iterator ii;
@@ -243,38 +201,224 @@ int SparseFillTheMatrix(const Equations &equations, const vector<Unique_basis_pa
             }
         }
 
+        if (Remove_duplicate_rows && !t_row.empty() && t_row[0].getElement() != S_one()) {
+            const Scalar inv = S_inv(t_row[0].getElement());
+            for (auto &node : t_row) node.setElement(S_mul(node.getElement(), inv));
+        }
+
         SparseRow &d_row = SM[se + eq_number];
         SparseRow(t_row.begin(), t_row.end()).swap(d_row); // shrink capacity while assigning
     }
 
+    if (Remove_duplicate_rows) {
+        *Duplicates = RemoveDuplicateRows(SM, se);
+    }
+
     return OK;
 }
 
 
-int GetCol(const vector<Unique_basis_pair> &ColtoBP, Basis Left_basis, Basis Right_basis) {
-    const int Num_unique_basis_pairs = ColtoBP.size();
-
-    int low = 0;
-    int high = Num_unique_basis_pairs - 1;
-
-    while (low <= high) {
-        int middle = (low + high) / 2;
-        if (Left_basis < ColtoBP[middle].left_basis) {
-            high = middle - 1;
-        } else if (Left_basis > ColtoBP[middle].left_basis) {
-            low = middle + 1;
-        } else {
-            if (Right_basis < ColtoBP[middle].right_basis) {
-                high = middle - 1;
-            } else if (Right_basis > ColtoBP[middle].right_basis) {
-                low = middle + 1;
-            } else {
-                return middle;
+static size_t HashRow(const SparseRow &row) {
+    size_t h = 14695981039346656037ULL;
+    for (const auto &n : row) {
+        h = (h ^ (size_t) n.getColumn()) * 1099511628211ULL;
+        h = (h ^ (size_t) n.getElement()) * 1099511628211ULL;
+    }
+    return h;
+}
+
+/* Drop the zero rows and the repeated normalized rows of SM from row se on, keeping the first of each and
+   the order of the rest. The rows are sharded by hash so the shards can be deduplicated in parallel.
+   Returns the number of rows dropped. */
+int RemoveDuplicateRows(SparseMatrix &SM, int se) {
+    const int n = SM.size() - se;
+
+    vector<size_t> hash(n);
+#pragma omp parallel for shared(SM, se, n, hash) schedule(dynamic, 256) default(none)
+    for (int i = 0; i < n; i++) {
+        hash[i] = HashRow(SM[se + i]);
+    }
+
+    vector<vector<int> > shards(Duplicate_shards);
+    for (int i = 0; i < n; i++) {
+        if (!SM[se + i].empty()) shards[hash[i] % Duplicate_shards].push_back(i);
+    }
+
+    vector<char> keep(n, false);
+#pragma omp parallel for shared(SM, se, hash, shards, keep) schedule(dynamic, 1) default(none)
+    for (int k = 0; k < Duplicate_shards; k++) {
+        auto row_hash = [&](int i) { return hash[i]; };
+        auto row_equal = [&](int i, int j) { return SM[se + i] == SM[se + j]; };
+        std::unordered_set<int, decltype(row_hash), decltype(row_equal)> seen(2 * shards[k].size(), row_hash, row_equal);
+        for (int i : shards[k]) {
+            keep[i] = seen.insert(i).second;
+        }
+    }
+
+    int m = se;
+    for (int i = 0; i < n; i++) {
+        if (!keep[i]) continue;
+        if (m != se + i) SM[m].swap(SM[se + i]);
+        m++;
+    }
+    SM.resize(m);
+
+    return se + n - m;
+}
+
+
+void CreatePairUniverse(Name N, vector<Unique_basis_pair> &ColtoBP) {
+    ColtoBP.clear();
+
+    const Degree d = GetDegreeName(N);
+
+    for (int d1 = 1; d1 < d; d1++) {
+        if (!AreBasisElements(d1) || !AreBasisElements(d - d1)) continue;
+
+        Name t1 = -1;
+        Basis b3 = 0;
+        Basis b4 = -1;
+        for (Basis i = BasisStart(d1); i <= BasisEnd(d1); i++) {
+            /* Basis elements of a type are consecutive, so the right factors only change with the type. */
+            if (GetType(i) != t1) {
+                t1 = GetType(i);
+                b3 = 0;
+                b4 = -1;
+                if (IsSubtype(t1, N)) {
+                    Name t2;
+                    SubtractTypeName(N, t1, &t2);
+                    if (BeginBasis(t2) != 0) {
+                        b3 = BeginBasis(t2);
+                        b4 = EndBasis(t2);
+                    }
+                }
+            }
+            for (Basis j = b3; j <= b4; j++) {
+                Unique_basis_pair bp;
+                bp.left_basis = i;
+                bp.right_basis = j;
+                ColtoBP.push_back(bp);
+            }
+        }
+    }
+}
+
+
+long CountPairUniverse(Name N) {
+    long count = 0;
+
+    const Degree d = GetDegreeName(N);
+
+    for (int d1 = 1; d1 < d; d1++) {
+        if (!AreBasisElements(d1) || !AreBasisElements(d - d1)) continue;
+
+        /* Basis elements of a type are consecutive, so the pairs are counted a type at a time. */
+        for (Basis i = BasisStart(d1); i <= BasisEnd(d1); ) {
+            const Name t1 = GetType(i);
+            const Basis e = EndBasis(t1);
+            if (IsSubtype(t1, N)) {
+                Name t2;
+                SubtractTypeName(N, t1, &t2);
+                if (BeginBasis(t2) != 0) {
+                    count += (long) (e - i + 1) * (EndBasis(t2) - BeginBasis(t2) + 1);
+                }
+            }
+            i = e + 1;
+        }
+    }
+
+    return count;
+}
+
+
+int SparseAppendEquations(const Equations &equations, const ColumnIndex &Columns, SparseMatrix &SM,
+                          vector<char> &used, int *Duplicates) {
+    for (const auto &eqn : equations) {
+        for (const auto &terms : eqn) {
+            for (const auto &bp : terms) {
+                used[Columns.column(bp.left_basis, bp.right_basis)] = true;
             }
         }
     }
 
-    return -1;
+    return SparseFillTheMatrix(equations, Columns, SM, Duplicates);
+}
+
+
+ColumnIndex::ColumnIndex(Degree d) : blocks(), row_block(), bits(), before(), num_pairs(0) {
+    size_t words = 0;
+    for (Degree d1 = 1; d1 < d; d1++) {
+        if (!AreBasisElements(d1) || !AreBasisElements(d - d1)) continue;
+
+        Block b;
+        b.row_start = BasisStart(d1);
+        b.row_end = BasisEnd(d1);
+        b.col_start = BasisStart(d - d1);
+        b.col_end = BasisEnd(d - d1);
+        b.words_per_row = (b.col_end - b.col_start + 1 + 63) / 64;
+        b.first_word = words;
+        words += (size_t) (b.row_end - b.row_start + 1) * b.words_per_row;
+
+        if ((int) row_block.size() <= b.row_end) {
+            row_block.resize(b.row_end + 1, -1);
+        }
+        for (Basis i = b.row_start; i <= b.row_end; i++) {
+            row_block[i] = blocks.size();
+        }
+        blocks.push_back(b);
+    }
+
+    bits.assign(words, 0);
+}
+
+
+ColumnIndex::ColumnIndex(Degree d, const vector<Unique_basis_pair> &ColtoBP) : ColumnIndex(d) {
+    for (const auto &bp : ColtoBP) {
+        insert(bp.left_basis, bp.right_basis);
+    }
+    finish();
+}
+
+
+void ColumnIndex::insert(Basis left, Basis right) {
+    size_t w;
+    uint64_t bit;
+    if (locate(left, right, &w, &bit) && !(bits[w] & bit)) {
+#pragma omp atomic
+        bits[w] |= bit;
+    }
+}
+
+
+/* The blocks follow each other in increasing order of left basis, so the words are in column order. */
+void ColumnIndex::finish() {
+    before.resize(bits.size());
+    int n = 0;
+    for (size_t w = 0; w < bits.size(); w++) {
+        before[w] = n;
+        n += __builtin_popcountll(bits[w]);
+    }
+    num_pairs = n;
+}
+
+
+void ColumnIndex::pairs(vector<Unique_basis_pair> &ColtoBP) const {
+    ColtoBP.clear();
+    ColtoBP.reserve(num_pairs);
+
+    for (const Block &b : blocks) {
+        for (Basis i = b.row_start; i <= b.row_end; i++) {
+            const size_t w0 = b.first_word + (size_t) (i - b.row_start) * b.words_per_row;
+            for (int k = 0; k < b.words_per_row; k++) {
+                for (uint64_t word = bits[w0 + k]; word != 0; word &= word - 1) {
+                    Unique_basis_pair bp;
+                    bp.left_basis = i;
+                    bp.right_basis = b.col_start + k * 64 + __builtin_ctzll(word);
+                    ColtoBP.push_back(bp);
+                }
+            }
+        }
+    }
 }
 
 
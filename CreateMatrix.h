@@ -53,12 +53,98 @@ typedef struct {
     Basis right_basis;
 } Unique_basis_pair;
 
+/* The columns of a set of basis pairs of degree d, numbered in increasing order of (left, right) basis.
+   The pairs of basis elements of degrees d1 and d - d1 make up one block of a bitmap, a row of words for
+   each left basis, and each word keeps the number of pairs before it, so the column of a pair is found in
+   constant time. */
+class ColumnIndex {
+public:
+    /* No pairs yet. */
+    explicit ColumnIndex(Degree d);
+
+    /* The pairs of ColtoBP, in increasing order, each pair's column being its index in ColtoBP. */
+    ColumnIndex(Degree d, const std::vector<Unique_basis_pair> &ColtoBP);
+
+    /* Add a pair. Pairs may be inserted concurrently, and are numbered by finish(). */
+    void insert(Basis left, Basis right);
+    void finish();
+
+    int size() const { return num_pairs; }
+
+    /* The pairs in column order. */
+    void pairs(std::vector<Unique_basis_pair> &ColtoBP) const;
+
+    /* The column of a pair, or -1 if it is not in the set. */
+    int column(Basis left, Basis right) const {
+        size_t w;
+        uint64_t bit;
+        if (!locate(left, right, &w, &bit) || !(bits[w] & bit)) {
+            return -1;
+        }
+        return before[w] + __builtin_popcountll(bits[w] & (bit - 1));
+    }
+
+private:
+    struct Block {
+        Basis row_start;
+        Basis row_end;
+        Basis col_start;
+        Basis col_end;
+        int words_per_row;
+        size_t first_word;
+    };
+
+    bool locate(Basis left, Basis right, size_t *w, uint64_t *bit) const {
+        if (left <= 0 || left >= (Basis) row_block.size() || row_block[left] < 0) {
+            return false;
+        }
+        const Block &b = blocks[row_block[left]];
+        if (right < b.col_start || right > b.col_end) {
+            return false;
+        }
+        const int c = right - b.col_start;
+        *w = b.first_word + (size_t) (left - b.row_start) * b.words_per_row + c / 64;
+        *bit = (uint64_t) 1 << (c % 64);
+        return true;
+    }
+
+    std::vector<Block> blocks;
+    std::vector<int> row_block;         /* The block of each left basis, or -1. */
+    std::vector<uint64_t> bits;
+    std::vector<int> before;            /* The number of pairs in the words before each. */
+    int num_pairs;
+};
+
 typedef std::vector<std::vector<Basis_pair> > Equation;
 typedef std::vector<Equation> Equations;
 
+/* Receives equations as they are generated, instead of them being kept until the matrix is built. */
+class EquationSink {
+public:
+    virtual ~EquationSink() {}
+
+    /* Consume, and clear, the equations generated so far. */
+    virtual void consume(Equations &equations) = 0;
+
+    /* True once the equations consumed have full rank on all columns, so further ones change nothing. */
+    virtual bool saturated() const { return false; }
+};
+
+/* Zero rows and rows repeating another up to a scalar are dropped, and counted in Duplicates. */
 int SparseCreateTheMatrix(const Equations &equations, SparseMatrix &SM, int *Cols,
-                          std::vector<Unique_basis_pair> &BPCptr, Name n);
+                          std::vector<Unique_basis_pair> &BPCptr, Name n, int *Duplicates);
+
+/* All basis pairs whose product has type n, in column order. The columns of SparseCreateTheMatrix()
+   are those of the pairs present in the equations. */
+void CreatePairUniverse(Name n, std::vector<Unique_basis_pair> &ColtoBP);
+
+/* The number of pairs of CreatePairUniverse(), without listing them. */
+long CountPairUniverse(Name n);
 
-int GetCol(const std::vector<Unique_basis_pair> &ColtoBP, Basis Left_basis, Basis Right_basis);
+/* Append a row to SM for each equation, with columns from Columns, and mark the columns of the pairs
+   present in used, including those whose coefficients cancel. Zero rows and rows repeating another of
+   the same equations up to a scalar are dropped, and counted in Duplicates. */
+int SparseAppendEquations(const Equations &equations, const ColumnIndex &Columns,
+                          SparseMatrix &SM, std::vector<char> &used, int *Duplicates);
 
 #endif
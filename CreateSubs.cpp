@@ -42,18 +42,23 @@
 /*********************************************************************/
 
 #include <vector>
+#include <algorithm>
 
 using std::vector;
 
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <omp.h>
+
 #include "CreateSubs.h"
 #include "Build_defs.h"
 #include "Type_table.h"
 #include "CreateMatrix.h"
 #include "Memory_routines.h"
 #include "PerformSub.h"
+#include "Scalar_arithmetic.h"
+#include "Session.h"
 #include "Po_parse_exptext.h"
 #include "Debug.h"
 
@@ -62,43 +67,49 @@ using std::vector;
 static void PrintSubstitution(const vector<Basis> &Substitution);
 #endif
 
-int CreateSubs(Equations &equations, const struct polynomial *F, int nVars, int maxDegVar, const vector<vector<Basis> > &all_Substitutions, const int *Deg_var)
+int CreateSubs(GenerationContext &ctx, Equations &equations, const vector<vector<Basis> > &all_Substitutions)
 {
     int status = OK;
  
-    int se = equations.size();
     int as = all_Substitutions.size();
-    equations.resize(se + as);
-
-    //vector<vector<vector<Basis_pair> > > res(as);
-    {
-      vector<vector<vector<int> > > permutations;
-      int ps = 0;
-      {
-        BuildPermutationLists(nVars, Deg_var, permutations);
-        ps = permutations.size();
-          for(int i=0; i<as; i++) {
-            //res[i].resize(ps);
-            equations[se + i].resize(ps);
-          }
-      }
-
-//printf("<%d %d %d>\n", all_Substitutions.size(), Substitutions.size(), permutations.size());
-#pragma omp parallel for schedule(dynamic, 2) collapse(2)
-        for(int i=0; i<as; i++) {
-          for(int j=0; j<ps; j++) {
-            status = PerformSubs(all_Substitutions[i], F, maxDegVar, permutations[j], equations[se + i][j]);
-          }
+
+    /* With a sink, the substitutions are performed in blocks, handing the equations over after each,
+       so generation stops as soon as the sink is saturated. */
+    int block = ctx.sink ? std::max(1, ctx.sink_min_equations) : as;
+
+    const GenerationContext &cctx = ctx;
+
+    for (int b0 = 0; b0 < as && status == OK && !ctx.saturated(); b0 += block) {
+        int b1 = std::min(as, b0 + block);
+        int se = equations.size();
+        equations.resize(se + b1 - b0);
+
+        /* Each substitution is only expanded for the permutations giving distinct terms, and the terms
+           scaled by the number of permutations each stands for. */
+#pragma omp parallel for schedule(dynamic, 2) copyin(Current_session, Current_field)
+        for (int i = b0; i < b1; i++) {
+            vector<vector<vector<int> > > permutations;
+            const Scalar multiplicity = BuildDistinctPermutationLists(all_Substitutions[i], cctx.num_vars, cctx.max_deg_var,
+                                                                      cctx.deg_vars.data(), permutations);
+
+            const int tid = omp_get_thread_num();
+            SubMemo spare;
+            SubMemo &memo = tid < (int) ctx.memos.size() ? ctx.memos[tid] : spare;
+
+            Equation &eqn = equations[se + i - b0];
+            eqn.resize(permutations.size());
+            for (int j = 0; j < (int) permutations.size(); j++) {
+                status = PerformSubs(cctx, memo, all_Substitutions[i], permutations[j], eqn[j]);
+                if (multiplicity != S_one()) {
+                    for (auto &bp : eqn[j]) bp.coef = S_mul(multiplicity, bp.coef);
+                }
+            }
         }
-      }
-
-//printf("se:%d ass:%d ", se, as);
-#if 0
-      for(int i=0; i<as; i++) {
-        LocalListToEquation(res[i], equations[se + i]);
-        //AppendLocalListToTheList(res[i], equations);
-      }
-#endif
+
+        if (ctx.sink && status == OK && (int) equations.size() >= ctx.sink_min_equations) {
+            ctx.sink->consume(equations);
+        }
+    }
 
     return(status);
 }
@@ -41,15 +41,16 @@ static void PrintDependent(void);
 #endif
 static void ProcessIndependentBasis(const vector<int> &Dependent, const vector<Unique_basis_pair> &ColtoBP, vector<Basis> &BasisNames);
 static void SparseProcessDependentBasis(const SparseMatrix &SM, const vector<Unique_basis_pair> &ColtoBP, vector<Basis> &BasisNames);
-static void ProcessOtherIndependentBasis(const vector<Unique_basis_pair> &ColtoBP, int J);
+static void ProcessOtherIndependentBasis(const ColumnIndex &Columns, int J);
 
-static Type Cur_type;
-static Type T1;
-static Type T2;
-static int Cur_type_degree;
-static int Cur_type_len;
-static int Num_cols;
-static int MatrixRank;
+/* Extraction runs in the thread of its build, so builds of different sessions each have their own. */
+static thread_local Type Cur_type;
+static thread_local Type T1;
+static thread_local Type T2;
+static thread_local int Cur_type_degree;
+static thread_local int Cur_type_len;
+static thread_local int Num_cols;
+static thread_local int MatrixRank;
 
 /* Added (8/92) by DCL. This is virtually identical to ExtractFromMatrix()
    except for the calls to SparseFillDependent() and SparseProcessDependent-
@@ -57,6 +58,12 @@ static int MatrixRank;
    matrix and then that pointer is copied to the one passed in upon exit */
    
 int SparseExtractFromMatrix(const SparseMatrix &SM, int Cols, int Rank, Name N, const vector<Unique_basis_pair> &ColtoBP)
+{
+    return SparseExtractFromMatrix(SM, Cols, Rank, N, ColtoBP, ColtoBP);
+}
+
+int SparseExtractFromMatrix(const SparseMatrix &SM, int Cols, int Rank, Name N, const vector<Unique_basis_pair> &ColtoBP,
+                            const vector<Unique_basis_pair> &SortedColtoBP)
 {
     Num_cols = Cols;
     MatrixRank = Rank;
@@ -84,7 +91,7 @@ int SparseExtractFromMatrix(const SparseMatrix &SM, int Cols, int Rank, Name N,
         SparseProcessDependentBasis(SM, ColtoBP, BasisNames);
     }
 
-    ProcessOtherIndependentBasis(ColtoBP, 0);
+    ProcessOtherIndependentBasis(ColumnIndex(Cur_type_degree, SortedColtoBP), 0);
 
     free(Cur_type);
     free(T1);
@@ -133,15 +140,12 @@ void ProcessIndependentBasis(const vector<int> &Dependent, const vector<Unique_b
     if (Num_cols == 0)
         return;
 
-    vector<pair<Basis, Scalar> > tl(1);
-
     for (int j=0;j<Num_cols;j++) {
         if (!Dependent[j]) {
             Basis b1 = ColtoBP[j].left_basis;
             Basis b2 = ColtoBP[j].right_basis;
             Basis n = EnterBasis(b1,b2,TypeToName(Cur_type));
-            tl[0] = make_pair(n, 1);
-            EnterProduct(b1, b2, tl);
+            EnterDefiningProduct(b1, b2, n);
             BasisNames[j] = n;
         }
     }
@@ -179,10 +183,8 @@ void SparseProcessDependentBasis(const SparseMatrix &SM, const vector<Unique_bas
     }
 }
 
-void ProcessOtherIndependentBasis(const vector<Unique_basis_pair> &ColtoBP, int J)
+void ProcessOtherIndependentBasis(const ColumnIndex &Columns, int J)
 {
-   vector<pair<Basis, Scalar> > tl(1);
-
     if (Cur_type_len == J) {
         int deg = GetDegree(T1);
         if ((deg > 0) && (deg < Cur_type_degree)) {
@@ -195,10 +197,9 @@ void ProcessOtherIndependentBasis(const vector<Unique_basis_pair> &ColtoBP, int
             if ((0 < m1) && (m1 <= m2) && (0 < n1) && (n1 <= n2)) {
                 for (int i=m1;i<=m2;i++) {
                     for (int j=n1;j<=n2;j++) {
-                        if (GetCol(ColtoBP, i, j) == -1) {
+                        if (Columns.column(i, j) == -1) {
                             Basis n = EnterBasis(i,j,TypeToName(Cur_type));
-                            tl[0] = make_pair(n, 1);
-                            EnterProduct(i, j, tl);
+                            EnterDefiningProduct(i, j, n);
                         }
                     }
                 }
@@ -209,7 +210,7 @@ void ProcessOtherIndependentBasis(const vector<Unique_basis_pair> &ColtoBP, int
         for (int i=0;i<=Cur_type[J];i++) {
             Degree save = T1[i];
             T1[J] = i;
-            ProcessOtherIndependentBasis(ColtoBP, J+1);
+            ProcessOtherIndependentBasis(Columns, J+1);
             T1[i] = save;
         }
     }
@@ -6,5 +6,10 @@
 
 int SparseExtractFromMatrix(const SparseMatrix &SM, int nCols, int Rank, Name N, const std::vector<Unique_basis_pair> &ColtoBP);
 
+/* As above, for a matrix with permuted columns. ColtoBP gives the basis pair of each column of SM, while
+   SortedColtoBP holds the same pairs in their original sorted order, as numbered by ColumnIndex. */
+int SparseExtractFromMatrix(const SparseMatrix &SM, int nCols, int Rank, Name N, const std::vector<Unique_basis_pair> &ColtoBP,
+                            const std::vector<Unique_basis_pair> &SortedColtoBP);
+
 #endif
 
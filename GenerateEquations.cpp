@@ -7,6 +7,7 @@
 /***  PUBLIC ROUTINES:                                             ***/
 /***      int GenerateEquations()                                  ***/
 /***      int GetVarNumber()                                       ***/
+/***      GenerationContext::GenerationContext()                   ***/
 /***      Eqn_list_node *GetNewEqnListNode()                       ***/
 /***      int FreeEqns()                                           ***/
 /***      int PrintEqns()                                          ***/
@@ -79,85 +80,77 @@ using std::vector;
 #include <stdlib.h>
 #include <string.h>
 
+#include <omp.h>
+
 #include "GenerateEquations.h"
 #include "Build_defs.h"
 #include "CreateMatrix.h"
 #include "Memory_routines.h"
 #include "Multpart.h"
+#include "PerformSub.h"
 #include "Po_parse_exptext.h"
 #include "Debug.h"
 #include "Type_table.h"
 
-static bool GenerateSeqSubtypes(int Cur_row, int Cur_col, int Weight, Equations &equations);
+static bool GenerateSeqSubtypes(GenerationContext &ctx, int Cur_row, int Cur_col, int Weight, Equations &equations);
 #if DEBUG_SEQ_SUBTYPES
-static void PrintSeqSubtypes(void);
+static void PrintSeqSubtypes(const GenerationContext &ctx);
 #endif
 #if 0
 static void PrintEqns(const Equations &equations);
 static void PrintEqn(Basis_pair *Temp_eqn);
 #endif
 
-static Type Target_type = NULL;
-static int Target_type_len = 0;
-static int Target_type_deg = 0;
-static int Num_vars = 0;
-static Type Seq_sub_types = NULL;
-static int *Deg_vars = NULL;
-static int *Cur_deg_vars = NULL;
-static int Whatsleft = 0;
-static const struct polynomial *The_ident = NULL;
-
 extern int sigIntFlag;		/* TW 10/8/93 - flag for Ctrl-C */
 
-int GenerateEquations(const struct polynomial *F, Name N, Equations &equations)
+GenerationContext::GenerationContext(const struct polynomial *F, Name N, EquationSink *sink_, int sink_min_equations_)
+    : ident(F), sink(sink_), sink_min_equations(sink_min_equations_), status(OK),
+      target_type(GetTargetLen()), target_type_len(GetTargetLen()), target_type_deg(GetDegreeName(N)), num_vars(0),
+      max_deg_var(0), deg_vars(), seq_sub_types(), cur_deg_vars(), whatsleft(target_type_deg), plan(),
+      memos(omp_get_max_threads())
 {
-    int i,j;
-
-    The_ident = F;
-
-    Target_type_len = GetTargetLen(); 
-    Target_type_deg = GetDegreeName(N);
-
-    Num_vars = 0;
-    for (i=0;i<NUM_LETTERS;i++)
-        if (The_ident->deg_letter[i] > 0)
-            Num_vars++;
-
-    Target_type = GetNewType(); 
-    assert_not_null(Target_type);
+    int i;
 
-    Seq_sub_types = (Type) (Mymalloc(Num_vars * Target_type_len * sizeof(Degree)));
-    assert_not_null(Seq_sub_types);
+    NameToType(N, target_type.data());
 
-    Deg_vars = (int *) (Mymalloc(Num_vars * sizeof(int)));
-    assert_not_null(Deg_vars);
+    for (i=0;i<NUM_LETTERS;i++) {
+        var_number[i] = -1;
+        if (ident->deg_letter[i] > 0) {
+            var_number[i] = num_vars++;
+            deg_vars.push_back(ident->deg_letter[i]);
+        }
+    }
 
-    Cur_deg_vars = (int *) (Mymalloc(Num_vars * sizeof(int)));
-    assert_not_null(Cur_deg_vars);
+    for (i=0;i<num_vars;i++)
+        if (deg_vars[i] > max_deg_var)
+            max_deg_var = deg_vars[i];
 
-    NameToType(N,Target_type);
+    seq_sub_types.assign(num_vars * target_type_len, 0);
+    cur_deg_vars.assign(num_vars, 0);
 
-    for (i=0,j=0;i<NUM_LETTERS;i++)
-        if (The_ident->deg_letter[i] > 0)
-            Deg_vars[j++] = The_ident->deg_letter[i];
+    CompileIdentity(*this, plan);
+}
 
-    Whatsleft = Target_type_deg;
 
-    memset(Cur_deg_vars, 0, sizeof(Cur_deg_vars[0]) * Num_vars);
-    memset(Seq_sub_types, 0, sizeof(Seq_sub_types[0]) * Num_vars * Target_type_len);
+int GenerateEquations(const struct polynomial *F, Name N, Equations &equations, EquationSink *sink, int sink_min_equations,
+                      GenerationStats *stats)
+{
+    GenerationContext ctx(F, N, sink, sink_min_equations);
 
-    bool status = GenerateSeqSubtypes(0,0,0, equations); /* Starting of deep recursive calls */
+    bool status = GenerateSeqSubtypes(ctx, 0,0,0, equations); /* Starting of deep recursive calls */
 
-    free(Seq_sub_types); Seq_sub_types = NULL;
-    free(Deg_vars); Deg_vars = NULL;
-    free(Cur_deg_vars); Cur_deg_vars = NULL;
-    free(Target_type); Target_type = NULL;
+    if (stats) {
+        for (const auto &memo : ctx.memos) {
+            stats->memo_lookups += memo.lookups;
+            stats->memo_hits += memo.hits;
+        }
+    }
 
     return(status);
 }
 
 
-bool GenerateSeqSubtypes(int Cur_row, int Cur_col, int Weight, Equations &equations)
+bool GenerateSeqSubtypes(GenerationContext &ctx, int Cur_row, int Cur_col, int Weight, Equations &equations)
 {
 #if DEBUG_SEQ_SUBTYPES
     static int count = 1;
@@ -167,55 +160,64 @@ bool GenerateSeqSubtypes(int Cur_row, int Cur_col, int Weight, Equations &equati
       return false;
     }
 
-    if (Cur_col == Target_type_len) {
+    if (ctx.saturated()) {     /* The remaining equations are all implied */
+      return true;
+    }
+
+    const int len = ctx.target_type_len;
+    Degree *seq_sub_types = ctx.seq_sub_types.data();
+    int *cur_deg_vars = ctx.cur_deg_vars.data();
+    const int *deg_vars = ctx.deg_vars.data();
+
+    if (Cur_col == len) {
 #if DEBUG_SEQ_SUBTYPES
         printf("Printing %d th SeqSubtypes \n",count++);
-        PrintSeqSubtypes();
+        PrintSeqSubtypes(ctx);
 #endif
-	bool rv = PerformMultiplePartition(The_ident, equations, Num_vars, Seq_sub_types, Deg_vars);
+	bool rv = PerformMultiplePartition(ctx, equations, seq_sub_types);
         return rv;
     }
-    else if (Cur_row == (Num_vars - 1)) {
-        if ((Cur_deg_vars[Cur_row] + Whatsleft) >= Deg_vars[Cur_row]) {
-            int csave = Cur_deg_vars[Cur_row];
-            int whatsave = Whatsleft;
-            int tsave = Seq_sub_types[Cur_row*Target_type_len + Cur_col]; 
-
-            Seq_sub_types[Cur_row*Target_type_len + Cur_col] = Target_type[Cur_col] - Weight;
-            Cur_deg_vars[Cur_row] += Seq_sub_types[Cur_row*Target_type_len + Cur_col];
-            Whatsleft -= Seq_sub_types[Cur_row*Target_type_len + Cur_col];
-
-            if ((Cur_col < (Target_type_len - 1)) ||
-               ((Cur_col == (Target_type_len - 1)) && 
-               (Cur_deg_vars[Cur_row] >= Deg_vars[Cur_row]))){
-                 if(!GenerateSeqSubtypes(0,Cur_col+1,0, equations)) return false;
+    else if (Cur_row == (ctx.num_vars - 1)) {
+        if ((cur_deg_vars[Cur_row] + ctx.whatsleft) >= deg_vars[Cur_row]) {
+            int csave = cur_deg_vars[Cur_row];
+            int whatsave = ctx.whatsleft;
+            int tsave = seq_sub_types[Cur_row*len + Cur_col]; 
+
+            seq_sub_types[Cur_row*len + Cur_col] = ctx.target_type[Cur_col] - Weight;
+            cur_deg_vars[Cur_row] += seq_sub_types[Cur_row*len + Cur_col];
+            ctx.whatsleft -= seq_sub_types[Cur_row*len + Cur_col];
+
+            if ((Cur_col < (len - 1)) ||
+               ((Cur_col == (len - 1)) && 
+               (cur_deg_vars[Cur_row] >= deg_vars[Cur_row]))){
+                 if(!GenerateSeqSubtypes(ctx, 0,Cur_col+1,0, equations)) return false;
 	    }
 
-            Cur_deg_vars[Cur_row] = csave; 
-            Whatsleft = whatsave;
-            Seq_sub_types[Cur_row*Target_type_len + Cur_col] = tsave; 
+            cur_deg_vars[Cur_row] = csave; 
+            ctx.whatsleft = whatsave;
+            seq_sub_types[Cur_row*len + Cur_col] = tsave; 
         }
     }
     else {
-        if ((Cur_deg_vars[Cur_row] + Whatsleft) >= Deg_vars[Cur_row]) {
-            for(int i=Target_type[Cur_col] - Weight;i>=0;i--) {
-                int csave = Cur_deg_vars[Cur_row];
-                int whatsave = Whatsleft;
-                int tsave = Seq_sub_types[Cur_row*Target_type_len + Cur_col]; 
-
-                Seq_sub_types[Cur_row*Target_type_len + Cur_col] = i; 
-                Cur_deg_vars[Cur_row] += i; 
-                Whatsleft -= i; 
+        if ((cur_deg_vars[Cur_row] + ctx.whatsleft) >= deg_vars[Cur_row]) {
+            for(int i=ctx.target_type[Cur_col] - Weight;i>=0;i--) {
+                int csave = cur_deg_vars[Cur_row];
+                int whatsave = ctx.whatsleft;
+                int tsave = seq_sub_types[Cur_row*len + Cur_col]; 
+
+                seq_sub_types[Cur_row*len + Cur_col] = i; 
+                cur_deg_vars[Cur_row] += i; 
+                ctx.whatsleft -= i; 
                 
-                if ((Cur_col < (Target_type_len - 1)) ||
-                   ((Cur_col == (Target_type_len - 1)) && 
-                   (Cur_deg_vars[Cur_row] >= Deg_vars[Cur_row]))){
-                     if(!GenerateSeqSubtypes(Cur_row+1,Cur_col,Weight+i, equations)) return false;
+                if ((Cur_col < (len - 1)) ||
+                   ((Cur_col == (len - 1)) && 
+                   (cur_deg_vars[Cur_row] >= deg_vars[Cur_row]))){
+                     if(!GenerateSeqSubtypes(ctx, Cur_row+1,Cur_col,Weight+i, equations)) return false;
 		}
 
-                Cur_deg_vars[Cur_row] = csave; 
-                Whatsleft = whatsave;
-                Seq_sub_types[Cur_row*Target_type_len + Cur_col] = tsave; 
+                cur_deg_vars[Cur_row] = csave; 
+                ctx.whatsleft = whatsave;
+                seq_sub_types[Cur_row*len + Cur_col] = tsave; 
             }
         }
     }
@@ -224,7 +226,7 @@ bool GenerateSeqSubtypes(int Cur_row, int Cur_col, int Weight, Equations &equati
 }
 
 
-int GetVarNumber(char Letter)
+int GetVarNumber(const struct polynomial *F, char Letter)
 {
     int var_num = 1;
     int i;
@@ -232,7 +234,7 @@ int GetVarNumber(char Letter)
     for (i=0;i<NUM_LETTERS;i++) {
         if ((Letter - 'a') == i)
             return(var_num);
-        else if (The_ident->deg_letter[i] > 0)
+        else if (F->deg_letter[i] > 0)
             var_num++;
     }
     printf("warning: GetVarNumber() fall through\n"); 
@@ -240,16 +242,14 @@ int GetVarNumber(char Letter)
 } 
 
 #if DEBUG_SEQ_SUBTYPES
-void PrintSeqSubtypes(void)
+void PrintSeqSubtypes(const GenerationContext &ctx)
 {
-    static int count = 1;
-
     int i,j;
 
-    for (i=0;i<Num_vars;i++) {
+    for (i=0;i<ctx.num_vars;i++) {
         printf("    ");
-        for (j=0;j<Target_type_len;j++)
-            printf("%d",Seq_sub_types[i*Target_type_len + j]);
+        for (j=0;j<ctx.target_type_len;j++)
+            printf("%d",ctx.seq_sub_types[i*ctx.target_type_len + j]);
         printf("\n");
     }
 }
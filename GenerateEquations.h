@@ -1,13 +1,142 @@
 #ifndef _GENERATE_EQUATIONS_H_
 #define _GENERATE_EQUATIONS_H_
 
+#include <unordered_map>
 #include <vector>
 
+#include "Alg_elements.h"
 #include "Build_defs.h"
 #include "CreateMatrix.h"
 #include "Po_parse_exptext.h"
 
-int GenerateEquations(const struct polynomial *F, Name N, Equations &equations);
-int GetVarNumber(char Letter);
+/* An identity compiled for substituting basis elements in it. The values are the letters of the identity,
+   then the products of its subwords, a subword occurring in several terms being one product. Each term is
+   the product of two values, whose basis pairs make up its part of the equation. */
+struct EvaluationPlan {
+    struct Letter {
+        int var;
+        int occurrence;
+    };
+    struct Product {
+        Product() : left(0), right(0), letters() {}
+
+        int left;                       /* The values multiplied. */
+        int right;
+        std::vector<int> letters;       /* The letters of the subword, in order. */
+    };
+    struct Term {
+        Scalar coef;
+        int left;
+        int right;
+    };
+
+    EvaluationPlan() : letters(), products(), terms() {}
+
+    std::vector<Letter> letters;
+    std::vector<Product> products;
+    std::vector<Term> terms;
+};
+
+/* The values of the plan computed by one thread, and the products of subwords it already computed, keyed
+   by the product and a hash of the basis elements substituted for its letters. The same subword products
+   recur across the permutations and substitutions of a type, e.g. the (ax)x of (((ax)x)x)x. Products
+   rarely found are no longer memoized after a trial, and the entries are dropped once there are
+   Max_entries of them. */
+struct SubMemo {
+    struct Key {
+        int product;
+        size_t letters_hash;
+        bool operator==(const Key &k) const { return product == k.product && letters_hash == k.letters_hash; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &k) const { return (size_t) k.product * 31 + k.letters_hash; }
+    };
+    struct Entry {
+        Entry() : letters(), product() {}
+
+        std::vector<Basis> letters;
+        Alg_element product;
+    };
+
+    struct ProductStats {
+        ProductStats() : lookups(0), hits(0) {}
+
+        long lookups;
+        long hits;
+    };
+
+    static const int Max_entries = 1 << 16;
+    static const int Min_degree = 3;    /* The product of two letters is one lookup in the multiplication table. */
+    static const int Trial_lookups = 256;   /* A product found in the memo in fewer than 1 in Min_hit_ratio */
+    static const int Min_hit_ratio = 8;     /* of its first Trial_lookups lookups is no longer memoized. */
+
+    SubMemo() : entries(), products(), lookups(0), hits(0), letters(), values(), needed(), value(), target() {}
+
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    std::vector<ProductStats> products;
+    long lookups;
+    long hits;
+
+    /* The basis elements substituted for the letters, and the values of the plan: those needed, where
+       each is, and where each product needed is computed. */
+    std::vector<Basis> letters;
+    std::vector<Alg_element> values;
+    std::vector<char> needed;
+    std::vector<const Alg_element *> value;
+    std::vector<Alg_element *> target;
+};
+
+/* Counters of the generation of equations, accumulated over calls of GenerateEquations(). */
+struct GenerationStats {
+    GenerationStats() : memo_lookups(0), memo_hits(0) {}
+
+    long memo_lookups;
+    long memo_hits;
+};
+
+/* The state of generating the equations of one identity for one type, shared by the sequential
+   subtypes, the set partitions and the substitutions. Generation keeps no other state, so the
+   equations of different identities or types can be generated concurrently, each with its own
+   context. With a sink, the equations are handed to it whenever at least sink_min_equations of
+   them have been generated, and generation stops once it is saturated. */
+class GenerationContext {
+public:
+    GenerationContext(const struct polynomial *F, Name N, EquationSink *sink = nullptr, int sink_min_equations = 0);
+
+    GenerationContext(const GenerationContext &) = delete;
+    GenerationContext &operator=(const GenerationContext &) = delete;
+
+    /* Whether the sink is saturated, so no more equations need be generated. */
+    bool saturated() const { return sink && sink->saturated(); }
+
+    const struct polynomial *ident;
+    EquationSink *sink;
+    int sink_min_equations;
+    int status;
+
+    /* The target type, and the variables of the identity. Var_number gives the variable of each letter. */
+    std::vector<Degree> target_type;
+    int target_type_len;
+    int target_type_deg;
+    int num_vars;
+    int max_deg_var;
+    std::vector<int> deg_vars;
+    int var_number[NUM_LETTERS];
+
+    /* The sequential subtypes being built, num_vars rows of target_type_len degrees. */
+    std::vector<Degree> seq_sub_types;
+    std::vector<int> cur_deg_vars;
+    int whatsleft;
+
+    /* The identity compiled for the substitutions. */
+    EvaluationPlan plan;
+
+    /* The memo of subword products of each thread performing the substitutions. */
+    std::vector<SubMemo> memos;
+};
+
+int GenerateEquations(const struct polynomial *F, Name N, Equations &equations, EquationSink *sink = nullptr,
+                      int sink_min_equations = 0, GenerationStats *stats = nullptr);
+int GetVarNumber(const struct polynomial *F, char Letter);
 
 #endif
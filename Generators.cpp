@@ -15,9 +15,8 @@
 #include "Generators.h"
 #include "Build_defs.h"
 #include "Po_parse_exptext.h"
+#include "Session.h"
 
-static char  Letter_BasisNumbers[NUM_LETTERS];	/* basis  -> letter */
-static Basis BasisNumber_letters[NUM_LETTERS];	/* letter -> basis  */
 
 
 /********************************************************************/
@@ -79,18 +78,19 @@ int Parse_generator_word(char Str[], struct P_type *Pntr)
 
 void AssignBasisNumberstoLetters(struct P_type ptype)
 {
+     GeneratorState &gs = CurrentSession().generators;
      int i;
      Basis cur_basis_num = 1;
 
      for (i=0;i<NUM_LETTERS;i++) {
-         Letter_BasisNumbers[i] = '#';		/* undefined */
-         BasisNumber_letters[i] = 0;
+         gs.Letter_BasisNumbers[i] = '#';		/* undefined */
+         gs.BasisNumber_letters[i] = 0;
      }
 
      for (i=0;i<NUM_LETTERS;i++) {
          if (ptype.degrees[i] > 0) {
-             Letter_BasisNumbers[cur_basis_num - 1] = ('a' + i);
-             BasisNumber_letters[i] = cur_basis_num++;
+             gs.Letter_BasisNumbers[cur_basis_num - 1] = ('a' + i);
+             gs.BasisNumber_letters[i] = cur_basis_num++;
          }
      }
 }
@@ -98,11 +98,13 @@ void AssignBasisNumberstoLetters(struct P_type ptype)
 /* Take a degree 1 basis element and translate back to a letter. */
 char GetLetterofBasis(Basis b)
 {
-   return (Letter_BasisNumbers[b - 1]);
+   GeneratorState &gs = CurrentSession().generators;
+   return (gs.Letter_BasisNumbers[b - 1]);
 }
 
 
 Basis GetBasisNumberofLetter(char c)
 {
-    return(BasisNumber_letters[c - 'a']);
+    GeneratorState &gs = CurrentSession().generators;
+    return(gs.BasisNumber_letters[c - 'a']);
 } 
@@ -33,8 +33,9 @@
 
 #define   DB_MEM_ALLOC    0
 
-static struct unexp_tnode *Free_tnode_queue = NULL;
-static int Num_free_tnodes = 0;
+/* Each thread keeps its own queue of free tnodes, so sessions may parse concurrently. */
+static thread_local struct unexp_tnode *Free_tnode_queue = NULL;
+static thread_local int Num_free_tnodes = 0;
 extern jmp_buf env;
 
 /*******************************************************************/
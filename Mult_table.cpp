@@ -13,17 +13,22 @@
 /***      Termptr RetrieveProduct()                              ***/
 /***      int EnterProduct()                                     ***/
 /***      int CreateMultTable()                                  ***/
+/***      bool EnterDefiningProduct()                            ***/
+/***      bool EnterRestoredProducts()                           ***/
 /***      int DestroyMultTable()                                 ***/
 /***      Mt_block *Alloc_Mt_block()                             ***/
 /***      Terms_block *Alloc_Terms_block()                       ***/
 /***  PRIVATE ROUTINES:                                          ***/
 /***      int TermsListLength()                                  ***/
 /***      int FreeTermsBlocks()                                  ***/ 
+/***      MultTableBlock &GetBlock()                             ***/
+/***      Degree GetBasisDegree()                                ***/
 /***  MODULE DESCRIPTION:                                        ***/
 /***      This module contains routines dealing with Algebraic   ***/
 /***      elements.                                              ***/
 /*******************************************************************/
 
+#include <algorithm>
 #include <map>
 #include <vector>
 
@@ -43,9 +48,9 @@
 //using std::map;
 using namespace std;
 
-mult_table_t mult_table;
-
 static void Print_AE(const Alg_element &ae, FILE *filePtr);
+static MultTableBlock *GetBlock(Basis B1, Basis B2);
+static Degree GetBasisDegree(MultTable &mt, Basis b);
 
 /*******************************************************************/
 /* MODIFIES: None.                                                 */
@@ -61,7 +66,139 @@ static void Print_AE(const Alg_element &ae, FILE *filePtr);
 /*******************************************************************/ 
 void DestroyMultTable()
 {
-  mult_table.clear();
+  CurrentSession().mult_table = MultTable();
+}
+
+
+/*******************************************************************/
+/* REQUIRES:                                                       */
+/*     B1, B2 -- basis elements of degrees already complete.       */
+/*     tl -- the terms of the product B1*B2.                       */
+/* FUNCTION:                                                       */
+/*     Enter the product B1*B2 at its slot of the block of the     */
+/*     degrees of B1 and B2, appending its terms to the block.     */
+/*******************************************************************/
+bool EnterProduct(Basis B1, Basis B2, const vector<pair<Basis, Scalar> > &tl)
+{
+  MultTableBlock *block = GetBlock(B1, B2);
+  if(block == NULL) {
+    return false;
+  }
+
+  MultTableBlock::Slot &slot = block->slots[(B1 - block->row_start) * block->cols + (B2 - block->col_start)];
+  if(slot.count != MultTableBlock::Slot::Absent) {
+    puts("already present");
+    return true;
+  }
+
+  slot.begin = block->terms.size();
+  slot.count = tl.size();
+  block->terms.insert(block->terms.end(), tl.begin(), tl.end());
+  CurrentSession().mult_table.num_products++;
+
+  return true;
+}
+
+
+/*******************************************************************/
+/* REQUIRES:                                                       */
+/*     n -- a new basis element, entered with factors B1 and B2.   */
+/* FUNCTION:                                                       */
+/*     Enter the product B1*B2 = n. Its slot keeps n in place of   */
+/*     terms, and it is not saved, being restored from the basis   */
+/*     table.                                                      */
+/*******************************************************************/
+bool EnterDefiningProduct(Basis B1, Basis B2, Basis n)
+{
+  MultTableBlock *block = GetBlock(B1, B2);
+  if(block == NULL) {
+    return false;
+  }
+
+  MultTableBlock::Slot &slot = block->slots[(B1 - block->row_start) * block->cols + (B2 - block->col_start)];
+  if(slot.count != MultTableBlock::Slot::Absent) {
+    puts("already present");
+    return true;
+  }
+
+  slot.begin = n;
+  slot.count = MultTableBlock::Slot::Defining;
+
+  return true;
+}
+
+
+/*******************************************************************/
+/* RETURNS:                                                        */
+/*     The block of the products of the degrees of B1 and B2,      */
+/*     created if needed, or NULL if B1 or B2 is not a basis.      */
+/* FUNCTION:                                                       */
+/*     Products of degree d are entered once all basis elements of */
+/*     lower degrees are, so a block is sized by the basis table   */
+/*     when its first product is entered.                          */
+/*******************************************************************/
+MultTableBlock *GetBlock(Basis B1, Basis B2)
+{
+  MultTable &mt = CurrentSession().mult_table;
+
+  const Degree d1 = GetBasisDegree(mt, B1);
+  const Degree d2 = GetBasisDegree(mt, B2);
+  if(d1 == 0 || d2 == 0) {
+    return NULL;
+  }
+
+  if((int)mt.blocks.size() < d1) {
+    mt.blocks.resize(d1);
+  }
+  if((int)mt.blocks[d1-1].size() < d2) {
+    mt.blocks[d1-1].resize(d2);
+  }
+
+  MultTableBlock &block = mt.blocks[d1-1][d2-1];
+  if(block.cols == 0) {
+    block.row_start = BasisStart(d1);
+    block.col_start = BasisStart(d2);
+    block.cols = BasisEnd(d2) - block.col_start + 1;
+    block.slots.resize((BasisEnd(d1) - block.row_start + 1) * block.cols);
+  }
+
+  return &block;
+}
+
+
+/*******************************************************************/
+/* RETURNS:                                                        */
+/*     The degree of the basis element b, or 0 if b is not one.    */
+/* FUNCTION:                                                       */
+/*     basis_degree is extended from the basis table only when b   */
+/*     is past its end, walking down from the highest degree over  */
+/*     the basis elements added since, so each is entered once.    */
+/*******************************************************************/
+Degree GetBasisDegree(MultTable &mt, Basis b)
+{
+  if(b <= 0) {
+    return 0;
+  }
+
+  if(b >= (Basis)mt.basis_degree.size()) {
+    const vector<pair<Basis, Basis> > &degrees = CurrentSession().basis.Deg_to_basis_table;
+    const Basis old_size = max((Basis)mt.basis_degree.size(), (Basis)1);
+
+    if(!degrees.empty() && degrees.back().second >= old_size) {
+      mt.basis_degree.resize(degrees.back().second + 1, 0);
+    }
+    for(int d = (int)degrees.size(); d >= 1 && degrees[d-1].second >= old_size; d--) {
+      for(Basis i = max(degrees[d-1].first, old_size); i <= degrees[d-1].second; i++) {
+        mt.basis_degree[i] = d;
+      }
+    }
+
+    if(b >= (Basis)mt.basis_degree.size()) {
+      return 0;
+    }
+  }
+
+  return mt.basis_degree[b];
 }
 
 
@@ -106,7 +243,7 @@ void Print_AE(const Alg_element &ae, FILE *filePtr) /* TW 9/19/93 - add 2 params
   int trmcnt = 0;		/* How many terms have been printed */
   int lnecnt = 0;		/* How many have been printed on current line */
 
-  map<Basis, Scalar>::const_iterator aei;
+  Alg_element::const_iterator aei;
   for(aei = ae.begin(); aei != ae.end(); aei++) {
     if(aei->first != 0 && aei->second != 0) {
       int x = aei->second; 
@@ -126,36 +263,51 @@ void Print_AE(const Alg_element &ae, FILE *filePtr) /* TW 9/19/93 - add 2 params
 }
 
 bool save_mult_table(FILE *f) {
-//    typedef std::map<std::pair<Basis, Basis>, std::vector<std::pair<Basis, Scalar> > > mult_table_t;
 //    typedef unsigned char Scalar;
 //    typedef int Basis;
 
-    const int ni = mult_table.size();
+    const MultTable &mult_table = CurrentSession().mult_table;
+
+    const int ni = mult_table.num_products;
     fwrite(&ni, sizeof(ni), 1, f);
 
-    for (const auto & i : mult_table) {
-        auto bb = i.first;
-        fwrite(&bb.first, sizeof(bb.first), 1, f);
-        fwrite(&bb.second, sizeof(bb.second), 1, f);
+    /* The products in increasing order of (b1, b2), the basis elements of each degree following those of lower ones. */
+    for (Basis b1 = 1; b1 < (Basis) mult_table.basis_degree.size(); b1++) {
+        const Degree d1 = mult_table.basis_degree[b1];
+        if (d1 == 0 || d1 > (Degree) mult_table.blocks.size()) continue;
 
-        int nj = i.second.size();
-        fwrite(&nj, sizeof(nj), 1, f);
+        for (const auto &block : mult_table.blocks[d1 - 1]) {
+            for (int c = 0; c < block.cols; c++) {
+                const MultTableBlock::Slot &slot = block.slots[(b1 - block.row_start) * block.cols + c];
+                if (slot.count < 0) continue;   /* Absent, or a defining product. */
 
-        for (auto bs : i.second) {
-            fwrite(&bs.first, sizeof(bs.first), 1, f);
-            fwrite(&bs.second, sizeof(bs.second), 1, f);
+                const Basis b2 = block.col_start + c;
+                fwrite(&b1, sizeof(b1), 1, f);
+                fwrite(&b2, sizeof(b2), 1, f);
+
+                int nj = slot.count;
+                fwrite(&nj, sizeof(nj), 1, f);
+
+                for (int j = slot.begin; j < slot.begin + slot.count; j++) {
+                    fwrite(&block.terms[j].first, sizeof(block.terms[j].first), 1, f);
+                    fwrite(&block.terms[j].second, sizeof(block.terms[j].second), 1, f);
+                }
+            }
         }
     }
 
     return true;
 }
 
+/* The products are kept until EnterRestoredProducts(), as the basis table sizing the blocks is saved after them. */
 bool restore_mult_table(FILE *f) {
-    mult_table.clear();
+    MultTable &mult_table = CurrentSession().mult_table;
+    mult_table = MultTable();
 
     int ni;
     fread(&ni, sizeof(ni), 1, f);
 
+    mult_table.restored.resize(ni);
     for (int i=0; i<ni; i++) {
         Basis b1, b2;
         fread(&b1, sizeof(b1), 1, f);
@@ -175,7 +327,34 @@ bool restore_mult_table(FILE *f) {
             row[j] = make_pair(b, s);
         }
 
-        mult_table.insert(make_pair(key, row));
+        mult_table.restored[i] = make_pair(key, row);
+    }
+
+    return true;
+}
+
+/* The defining products are entered from the basis table. Tables saved before they were left out also
+   hold them explicitly, and those are skipped. */
+bool EnterRestoredProducts() {
+    MultTable &mult_table = CurrentSession().mult_table;
+
+    vector<pair<pair<Basis, Basis>, vector<Product_term> > > restored;
+    restored.swap(mult_table.restored);
+
+    for (Basis n = 1; n < GetNextBasisTobeFilled(); n++) {
+        if (LeftFactor(n) != 0 && !EnterDefiningProduct(LeftFactor(n), RightFactor(n), n)) {
+            return false;
+        }
+    }
+
+    for (const auto &i : restored) {
+        Product_terms prod;
+        if (mult_table.find(i.first.first, i.first.second, prod)) {
+            continue;
+        }
+        if (!EnterProduct(i.first.first, i.first.second, i.second)) {
+            return false;
+        }
     }
 
     return true;
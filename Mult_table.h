@@ -11,13 +11,12 @@
 /*******************************************************************/
 
 #include <vector>
-#include <map>
+
+#include <stdio.h>
 
 #include "Build_defs.h"
 #include "Alg_elements.h"
-
-typedef std::map<std::pair<Basis, Basis>, std::vector<std::pair<Basis, Scalar> > > mult_table_t;
-extern mult_table_t mult_table;
+#include "Session.h"
 
 void DestroyMultTable();
 void Print_MultTable(FILE *filePtr);
@@ -25,33 +24,25 @@ void Print_MultTable(FILE *filePtr);
 bool save_mult_table(FILE *f);
 bool restore_mult_table(FILE *f);
 
-inline bool EnterProduct(Basis B1, Basis B2, const std::vector<std::pair<Basis, Scalar> > &tl)
-{
-  const std::pair<Basis, Basis> bb = std::make_pair(B1, B2);
-
-  if(mult_table.find(bb) == mult_table.end()) {
-    mult_table[bb] = tl;
-  } else {
-    puts("already present");
-  }
+bool EnterProduct(Basis B1, Basis B2, const std::vector<std::pair<Basis, Scalar> > &tl);
+bool EnterDefiningProduct(Basis B1, Basis B2, Basis n);
+bool EnterRestoredProducts();
 
-  return true;
+/* The terms of the product B1*B2 in the table, or false if it is not there. */
+inline bool FindProduct(Basis B1, Basis B2, Product_terms &prod)
+{
+  return CurrentSession().mult_table.find(B1, B2, prod);
 }
 
 inline bool Mult2basis(Basis B1, Basis B2, Scalar x, Alg_element &P)
 {
-  const std::pair<Basis, Basis> bb = std::make_pair(B1, B2);
-
-  auto ii = mult_table.find(bb);
-  if(ii == mult_table.end()) {
+  Product_terms prod;
+  if(!FindProduct(B1, B2, prod)) {
     return false;
   }
 
-  for(const auto & jj : ii->second) {
-    const Basis w = jj.first;
-    const Scalar coef = jj.second;
-    SetAE(P, w, S_add(GetAE(P, w), S_mul(x, coef)));
-    //AccumAE(P, w, S_mul(x, coef));
+  for(const auto & jj : prod) {
+    AccumAE(P, jj.first, S_mul(x, jj.second));
   }
 
   return true;
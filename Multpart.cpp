@@ -62,10 +62,8 @@
 /*********************************************************************/
 
 #include <vector>
-#include <algorithm>
 
 using std::vector;
-using std::max_element;
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -79,43 +77,36 @@ using std::max_element;
 #include "Po_parse_exptext.h"
 #include "Debug.h"
 
-static void SplitJthType(const vector<Name> &Var_types, int j, vector<Name> &Set_partitions, vector<int> &Cur_index_var, vector<vector<Basis> > &all_Substitutions);
-static void Gen(const vector<Name> &Var_types, Name n, int d, int j, vector<Name> &Set_partitions, vector<int> &Cur_index_var, vector<vector<Basis> > &all_Substitutions);
+static void SplitJthType(GenerationContext &ctx, const vector<Name> &Var_types, int j, vector<Name> &Set_partitions, vector<int> &Cur_index_var, vector<vector<Basis> > &all_Substitutions);
+static void Gen(GenerationContext &ctx, const vector<Name> &Var_types, Name n, int d, int j, vector<Name> &Set_partitions, vector<int> &Cur_index_var, vector<vector<Basis> > &all_Substitutions);
 static void AddSetPartition(int nVars, Name n, int j, vector<Name> &Set_partitions, vector<int> &Cur_index_var);
 static void DeleteSetPartition(Name j, vector<int> &Cur_index_var);
-static int OKSetPartitions(int nVars, const vector<Name> &Set_partitions);
+static int OKSetPartitions(const GenerationContext &ctx, const vector<Name> &Set_partitions);
 #if DEBUG_SET_PARTITIONS
 static void PrintVarTypes(void);
 static void PrintSetPartitions(void);
 #endif
 
-static const int *Deg_var_types = NULL;
-
-static int Max_deg_var = 0;
-static int status = OK;
-
 extern int sigIntFlag;		/* TW 10/8/93 - flag for Ctrl-C */
 
 
-int PerformMultiplePartition(const struct polynomial *The_ident, Equations &equations, int nVars, Type Types, const int *Deg_var)
+int PerformMultiplePartition(GenerationContext &ctx, Equations &equations, Type Types)
 {
-    Deg_var_types = Deg_var;
+    const int nVars = ctx.num_vars;
 
-    status = OK;
+    ctx.status = OK;
 
     vector<Name> Var_types(nVars);
     {
-        int target_type_len = GetTargetLen();
+        int target_type_len = ctx.target_type_len;
 
         for (int i=0;i<nVars;i++) {
             Var_types[i] = TypeToName(&Types[i*target_type_len + 0]);
         }
     }
 
-    Max_deg_var = *max_element(Deg_var_types, Deg_var_types + nVars);
-
 #if 0
-printf("mp: %d %d %d %d\n", nVars, NUM_LETTERS, target_type_len, Max_deg_var);
+printf("mp: %d %d %d %d\n", nVars, NUM_LETTERS, ctx.target_type_len, ctx.max_deg_var);
 #endif
 
 #if DEBUG_SET_PARTITIONS
@@ -129,15 +120,15 @@ printf("mp: %d %d %d %d\n", nVars, NUM_LETTERS, target_type_len, Max_deg_var);
 
     vector<vector<Basis> > all_Substitutions;
     {
-      vector<Name> Set_partitions(Max_deg_var * nVars, 0);
+      vector<Name> Set_partitions(ctx.max_deg_var * nVars, 0);
       vector<int> Cur_index_var(nVars, 0); 
 
-      SplitJthType(Var_types, 0, Set_partitions, Cur_index_var, all_Substitutions);     /* Start a recursive call. */
+      SplitJthType(ctx, Var_types, 0, Set_partitions, Cur_index_var, all_Substitutions);     /* Start a recursive call. */
     }
 
-    status = CreateSubs(equations, The_ident, nVars, Max_deg_var, all_Substitutions, Deg_var_types);
+    ctx.status = CreateSubs(ctx, equations, all_Substitutions);
 
-    return(status);
+    return(ctx.status);
 }
 
 
@@ -145,38 +136,38 @@ printf("mp: %d %d %d %d\n", nVars, NUM_LETTERS, target_type_len, Max_deg_var);
  * SplitJthType() and Gen() call each other recursively.
  */
 
-void SplitJthType(const vector<Name> &Var_types, int j, vector<Name> &Set_partitions, vector<int> &Cur_index_var, vector<vector<Basis> > &all_Substitutions)
+void SplitJthType(GenerationContext &ctx, const vector<Name> &Var_types, int j, vector<Name> &Set_partitions, vector<int> &Cur_index_var, vector<vector<Basis> > &all_Substitutions)
 {
-    if (status != OK)
+    if (ctx.status != OK)
         return;
 
     int nVars = Var_types.size();
 
     if (j < nVars) {
-        Gen(Var_types, Var_types[j], Deg_var_types[j], j, Set_partitions, Cur_index_var, all_Substitutions); //List);
-    } else if (OKSetPartitions(nVars, Set_partitions)) {
+        Gen(ctx, Var_types, Var_types[j], ctx.deg_vars[j], j, Set_partitions, Cur_index_var, all_Substitutions); //List);
+    } else if (OKSetPartitions(ctx, Set_partitions)) {
 #if DEBUG_SET_PARTITIONS
         PrintSetPartitions();
 #endif
-      vector<Basis> tmp(nVars * Max_deg_var);
+      vector<Basis> tmp(nVars * ctx.max_deg_var);
       //all_Substitutions.resize(all_Substitutions.size() + 1);
-      BuildSubs(Set_partitions, Max_deg_var, Deg_var_types, 0, 0, tmp, nVars, all_Substitutions); //..back());
+      BuildSubs(Set_partitions, ctx.max_deg_var, ctx.deg_vars.data(), 0, 0, tmp, nVars, all_Substitutions); //..back());
     }
 }
 
 
-void Gen(const vector<Name> &Var_types, Name n, int d, int j, vector<Name> &Set_partitions, vector<int> &Cur_index_var, vector<vector<Basis> > &all_Substitutions)
+void Gen(GenerationContext &ctx, const vector<Name> &Var_types, Name n, int d, int j, vector<Name> &Set_partitions, vector<int> &Cur_index_var, vector<vector<Basis> > &all_Substitutions)
 {
     int i,degn,lower,upper;
     Name n1,n_minus_n1;
 
     int nVars = Var_types.size();
 
-    if (status != OK)
+    if (ctx.status != OK)
         return;
     if (d == 1) {
         AddSetPartition(nVars, n,j, Set_partitions, Cur_index_var);
-        SplitJthType(Var_types, j+1, Set_partitions, Cur_index_var, all_Substitutions);
+        SplitJthType(ctx, Var_types, j+1, Set_partitions, Cur_index_var, all_Substitutions);
         DeleteSetPartition(j, Cur_index_var);
     }
     else {
@@ -188,11 +179,11 @@ void Gen(const vector<Name> &Var_types, Name n, int d, int j, vector<Name> &Set_
         upper = degn - d + 1;
         for (i=lower;i <= upper;i++) {
             n1 = FirstTypeDegree(i);
-            while ((n1 != -1) && (status == OK)) {
+            while ((n1 != -1) && (ctx.status == OK)) {
                 if (IsSubtype(n1,n)) {
                     AddSetPartition(nVars, n1, j, Set_partitions, Cur_index_var);
                     SubtractTypeName(n,n1,&n_minus_n1);
-                    Gen(Var_types, n_minus_n1, d-1, j, Set_partitions, Cur_index_var, all_Substitutions);
+                    Gen(ctx, Var_types, n_minus_n1, d-1, j, Set_partitions, Cur_index_var, all_Substitutions);
                     DeleteSetPartition(j, Cur_index_var);
                 }
                 n1 = NextTypeSameDegree(n1);
@@ -215,12 +206,13 @@ void DeleteSetPartition(Name j, vector<int> &Cur_index_var)
 }
 
 
-int OKSetPartitions(int nVars, const vector<Name> &Set_partitions)
+int OKSetPartitions(const GenerationContext &ctx, const vector<Name> &Set_partitions)
 {
     int i,j;
+    const int nVars = ctx.num_vars;
 
     for (j=0;j<nVars;j++)
-        for (i=0;i<(Deg_var_types[j]-1);i++)
+        for (i=0;i<(ctx.deg_vars[j]-1);i++)
             if (Set_partitions[i*nVars + j] < Set_partitions[(i+1)*nVars + j])
                 return(0);
 
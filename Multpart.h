@@ -3,7 +3,8 @@
 
 #include "Build_defs.h"
 #include "CreateSubs.h"
+#include "GenerateEquations.h"
 
-int PerformMultiplePartition(const struct polynomial *Id, Equations &equations, int Nvars, Type Types, const int *Deg_var);
+int PerformMultiplePartition(GenerationContext &ctx, Equations &equations, Type Types);
 
 #endif
@@ -8,6 +8,7 @@
 /***                        variables of this type                 ***/
 /***  PUBLIC ROUTINES:                                             ***/
 /***      int PerformSubs()                                        ***/
+/***      void CompileIdentity()                                   ***/
 /***  PRIVATE ROUTINES:                                            ***/
 /***      int FreePermutationList()                                ***/
 /***      int PrintPermutationList()                               ***/
@@ -22,8 +23,8 @@
 /***      int Expand()                                             ***/
 /***      int FreeLocalList()                                      ***/
 /***      int AppendToLocalList()                                  ***/
-/***      int SubstituteWord()                                     ***/
-/***      int Sub()                                                ***/
+/***      void CompileLetters()                                    ***/
+/***      int CompileWord()                                        ***/
 /***      Basis_pair_node *GetNewBPNode()                          ***/
 /***  MODULE DESCRIPTION:                                          ***/
 /***      Given an identity and a substitution record, we perform  ***/
@@ -69,17 +70,15 @@ static void PrintPermutation(int Var_num, Perm P);
 #endif
 //void BuildPermutationLists(int nVars, const int *Dv, vector<vector<vector<int> > > &permutations);
 static void BuildPermutations(int row, vector<vector<int> > &Permutation_list, vector<vector<vector<int> > > &permutations);
+static void BuildDistinctPermutations(int row, const vector<Basis> &S, int Mdv, vector<vector<int> > &Permutation_list, vector<vector<vector<int> > > &permutations);
 //static void AppendLocalListToTheList(const vector<vector<Basis_pair> > &Local_list, Eqn_list_node *L);
-static bool Expand(const vector<Basis> &Substitution, const struct polynomial *The_ident, vector<Basis_pair> &Local_list, const vector<vector<int> > &Permutation_list);
-static int SubstituteWord(const vector<Basis> &Substitution, const struct term_node *W, vector<Basis_pair> &running_list, const vector<vector<int> > &Permutation_list);
-static void Sub(const vector<Basis> &Substitution, Alg_element &Ans, const struct term_node *W, const vector<vector<int> > &Permutation_list);
+static bool Expand(const GenerationContext &ctx, SubMemo &memo, const vector<Basis> &Substitution, vector<Basis_pair> &Local_list, const vector<vector<int> > &Permutation_list);
+static void CompileLetters(const GenerationContext &ctx, const struct term_node *W, EvaluationPlan &plan, map<pair<int, int>, int> &letter_index);
+static int CompileWord(const GenerationContext &ctx, const struct term_node *W, EvaluationPlan &plan, const map<pair<int, int>, int> &letter_index, map<pair<int, int>, int> &product_index);
 
-static int Max_deg_var = 0;
-
-int PerformSubs(const vector<Basis> &S, const struct polynomial *F, int Mdv, vector<vector<int> > &permutation, vector<Basis_pair> &Local_list)
+int PerformSubs(const GenerationContext &ctx, SubMemo &memo, const vector<Basis> &S, const vector<vector<int> > &permutation, vector<Basis_pair> &Local_list)
 {
-    Max_deg_var = Mdv;
-    return Expand(S, F, Local_list, permutation);
+    return Expand(ctx, memo, S, Local_list, permutation);
 }
 
 void BuildPermutationLists(int nVars, const int *Dv, vector<vector<vector<int> > > &permutations) {
@@ -135,8 +134,55 @@ void BuildPermutations(int row, vector<vector<int> > &Permutation_list, vector<v
     } while(next_permutation(Permutation_list[row].begin(), Permutation_list[row].end()));
   }
 }
-        
-        
+
+
+/* Only the permutations of a substitution S that give distinct sequences of basis elements. Those that
+   just exchange equal basis elements of a variable give the same terms, so the sum over all permutations
+   is the sum over these times the multiplicity returned, the product of the factorials of the repeats.
+   When that is zero in the field, all permutations are listed instead and one is returned, so the
+   equation still has every basis pair present, even though they cancel. */
+Scalar BuildDistinctPermutationLists(const vector<Basis> &S, int nVars, int Mdv, const int *Dv, vector<vector<vector<int> > > &permutations)
+{
+    vector<vector<int> > Permutation_list(nVars);
+    Scalar multiplicity = S_one();
+
+    for(int rr=0; rr<nVars; rr++) {
+        vector<int> &p = Permutation_list[rr];
+        p.resize(Dv[rr]);
+        for(int i=0; i<(int)p.size(); i++) {
+            p[i] = i+1;
+        }
+        const Basis *b = &S[rr*Mdv];
+        stable_sort(p.begin(), p.end(), [b](int x, int y) { return b[x-1] < b[y-1]; });
+
+        for(int i=0, m=1; i<(int)p.size(); i++, m++) {
+            if(i == 0 || b[p[i]-1] != b[p[i-1]-1]) m = 1;
+            multiplicity = S_mul(multiplicity, ConvertToScalar(m));
+        }
+    }
+
+    if (multiplicity == S_zero()) {
+        BuildPermutationLists(nVars, Dv, permutations);
+        return S_one();
+    }
+
+    BuildDistinctPermutations(0, S, Mdv, Permutation_list, permutations);
+    return multiplicity;
+}
+
+void BuildDistinctPermutations(int row, const vector<Basis> &S, int Mdv, vector<vector<int> > &Permutation_list, vector<vector<vector<int> > > &permutations)
+{
+  if(row == (int)Permutation_list.size()) {
+    permutations.push_back(Permutation_list);
+  } else {
+    const Basis *b = &S[row*Mdv];
+    do {
+      BuildDistinctPermutations(row + 1, S, Mdv, Permutation_list, permutations);
+    } while(next_permutation(Permutation_list[row].begin(), Permutation_list[row].end(), [b](int x, int y) { return b[x-1] < b[y-1]; }));
+  }
+}
+
+
 void AppendLocalListToTheList(const vector<vector<Basis_pair> > &Local_lists, Equations &equations)
 {
 #if 0
@@ -173,120 +219,236 @@ printf("ll_l:%d lls:%d ", ll_length, (int)Local_lists.size());
 }
 
 /*
- * We are getting to the core of the internals.
+ * Compile the identity once for all substitutions. The letters are numbered first, then each subword
+ * becomes a product of two values, the same subword in several terms being one product.
  */
 
-bool Expand(const vector<Basis> &Substitution, const struct polynomial *The_ident, vector<Basis_pair> &Local_list, const vector<vector<int> > &Permutation_list)
+void CompileIdentity(const GenerationContext &ctx, EvaluationPlan &plan)
 {
-//putchar('#');
-    if (The_ident == NULL)
-        return true;
+    plan = EvaluationPlan();
 
-    term_head *temp_head = The_ident->terms;
+    if (ctx.ident == NULL)
+        return;
 
-    while (temp_head) {
-//putchar('*');
-        vector<Basis_pair> running_list;
+    map<pair<int, int>, int> letter_index;
+    for (term_head *temp_head = ctx.ident->terms; temp_head; temp_head = temp_head->next) {
+        CompileLetters(ctx, temp_head->term, plan, letter_index);
+    }
 
-        int alpha = temp_head->coef;
-        Scalar salpha = ConvertToScalar(alpha);
+    map<pair<int, int>, int> product_index;
+    for (term_head *temp_head = ctx.ident->terms; temp_head; temp_head = temp_head->next) {
+        const struct term_node *W = temp_head->term;
+
+        /* A term that is a letter has no basis pairs. */
+        if (W == NULL || (W->left == NULL && W->right == NULL))
+            continue;
+
+        EvaluationPlan::Term term;
+        term.coef = ConvertToScalar(temp_head->coef);
+        term.left = CompileWord(ctx, W->left, plan, letter_index, product_index);
+        term.right = CompileWord(ctx, W->right, plan, letter_index, product_index);
+        plan.terms.push_back(term);
+    }
+}
 
-        if (SubstituteWord(Substitution, temp_head->term, running_list, Permutation_list) != OK)
-            return false;
 
-        vector<Basis_pair>::iterator ii;
-        for(ii = running_list.begin(); ii != running_list.end(); ii++) {
-            ii->coef = S_mul(salpha, ii->coef);
+void CompileLetters(const GenerationContext &ctx, const struct term_node *W, EvaluationPlan &plan, map<pair<int, int>, int> &letter_index)
+{
+    if (W == NULL)
+        return;
+
+    if ((W->left == NULL) && (W->right == NULL)) {
+        EvaluationPlan::Letter letter;
+        letter.var = ctx.var_number[W->letter - 'a'];
+        letter.occurrence = W->number - 1;
+
+        pair<int, int> key(letter.var, letter.occurrence);
+        if (letter_index.find(key) == letter_index.end()) {
+            letter_index[key] = plan.letters.size();
+            plan.letters.push_back(letter);
         }
+    } else {
+        CompileLetters(ctx, W->left, plan, letter_index);
+        CompileLetters(ctx, W->right, plan, letter_index);
+    }
+}
+
+
+/* Returns the value of W, appending the products of its subwords not already in the plan. */
+int CompileWord(const GenerationContext &ctx, const struct term_node *W, EvaluationPlan &plan, const map<pair<int, int>, int> &letter_index, map<pair<int, int>, int> &product_index)
+{
+    const int nletters = plan.letters.size();
 
-        Local_list.insert(Local_list.end(), running_list.begin(), running_list.end());
-        temp_head = temp_head->next;
+    if ((W->left == NULL) && (W->right == NULL)) {
+        return letter_index.at(pair<int, int>(ctx.var_number[W->letter - 'a'], W->number - 1));
     }
 
-    return true;
+    int left = CompileWord(ctx, W->left, plan, letter_index, product_index);
+    int right = CompileWord(ctx, W->right, plan, letter_index, product_index);
+
+    pair<int, int> key(left, right);
+    map<pair<int, int>, int>::const_iterator ii = product_index.find(key);
+    if (ii != product_index.end())
+        return ii->second;
+
+    EvaluationPlan::Product product;
+    product.left = left;
+    product.right = right;
+    for (int v : {left, right}) {
+        if (v < nletters)
+            product.letters.push_back(v);
+        else
+            product.letters.insert(product.letters.end(), plan.products[v - nletters].letters.begin(), plan.products[v - nletters].letters.end());
+    }
+
+    int v = nletters + plan.products.size();
+    plan.products.push_back(product);
+    product_index[key] = v;
+    return v;
 }
 
 
 /*
  * THE HEART OF THE MATTER. WE HAVE REACHED THE CORE.
  * THE WHOLE IDEA OF DYNAMIC PROGRAMMING IS EMBEDDED IN THIS ROUTINE.
- * Form one term of the equation corresponding to the term in the
- * identity. 
+ * Substitute in the letters, multiply out the products of the subwords,
+ * and form the terms of the equation from the products of their two
+ * factors. We can't multiply those, because we are entering new basis
+ * elements of the degree of the identity. The equations are nothing but
+ * summation of basis pairs.
  */
 
-int SubstituteWord(const vector<Basis> &Substitution, const struct term_node *W, vector<Basis_pair> &running_list, const vector<vector<int> > &Permutation_list)
+bool Expand(const GenerationContext &ctx, SubMemo &memo, const vector<Basis> &Substitution, vector<Basis_pair> &Local_list, const vector<vector<int> > &Permutation_list)
 {
-    Alg_element ae1;
-    Alg_element ae2;
+    const EvaluationPlan &plan = ctx.plan;
+    const int nletters = plan.letters.size();
+    const int nproducts = plan.products.size();
+    const int nvalues = nletters + nproducts;
+
+    if (memo.values.size() < (size_t) nvalues) {
+        memo.values.resize(nvalues);
+        memo.value.resize(nvalues);
+        memo.needed.resize(nvalues);
+        memo.target.resize(nproducts);
+    }
+    if (memo.products.size() < (size_t) nproducts) {
+        memo.products.resize(nproducts);
+    }
+    if ((int) memo.entries.size() >= SubMemo::Max_entries) {
+        memo.entries.clear();
+    }
 
-    Scalar zero = S_zero();
-    Scalar alpha,beta;
+    memo.letters.resize(nletters);
+    for (int k = 0; k < nletters; k++) {
+        const EvaluationPlan::Letter &letter = plan.letters[k];
+        int perm_number = Permutation_list[letter.var][letter.occurrence] - 1;
+        memo.letters[k] = Substitution[letter.var*ctx.max_deg_var + perm_number];
+    }
 
-    if (W == NULL){
-        return(OK);
+    /* Find the values needed from the terms down. The product only depends on the basis elements
+       substituted in its letters, so it is looked up in the memo, and the values below it are not
+       needed when found. A missing product is entered in the memo, unless its hash is taken by other
+       basis elements. */
+    std::fill(memo.needed.begin(), memo.needed.begin() + nvalues, 0);
+    for (const EvaluationPlan::Term &term : plan.terms) {
+        memo.needed[term.left] = 1;
+        memo.needed[term.right] = 1;
     }
 
-    Sub(Substitution, ae1, W->left, Permutation_list);   /* We can expand left tree of W. *//* TW 9/22/93 - change ae1 to *ae1 */
-    Sub(Substitution, ae2, W->right, Permutation_list);  /* We can expand the right tree of W. *//* TW 9/22/93 - change ae2 to *ae2 */
-
-/* We can't do any more expansion. i.e We can't multiply ae1 & ae2. */
-/* Because we are entering new basis elements of degree of W. */
-/* But now it is time for new basis pairs. */
-/* The equations are nothing but summation of basis pairs. */
-
-    map<Basis, Scalar>::const_iterator ae1i, ae2i;
-    
-    ae1i = ae1.begin();
-    while(ae1i != ae1.end()) {
-      if(ae1i->first != 0) {
-        alpha = ae1i->second;
-        if (alpha != zero) { /* TW 9/22/93 - change ae1 to *ae1 */
-          ae2i = ae2.begin();
-          while(ae2i != ae2.end()) {
-            if(ae2i->first != 0) {
-                beta = ae2i->second; /* TW 9/22/93 - change ae2 to *ae2 */
-                if(beta != zero) { /* TW 9/22/93 - change ae2 to *ae2 */
-                    Basis_pair bp;
-                    bp.coef = S_mul(alpha, beta);
-                    bp.left_basis = ae1i->first;
-                    bp.right_basis = ae2i->first;
-                    running_list.push_back(bp);
+    for (int p = nproducts - 1; p >= 0; p--) {
+        const EvaluationPlan::Product &product = plan.products[p];
+        const int v = nletters + p;
+
+        if (!memo.needed[v])
+            continue;
+
+        memo.target[p] = &memo.values[v];
+
+        const int degree = product.letters.size();
+        SubMemo::ProductStats &stats = memo.products[p];
+        if (degree >= SubMemo::Min_degree &&
+            !(stats.lookups >= SubMemo::Trial_lookups && stats.hits * SubMemo::Min_hit_ratio < stats.lookups)) {
+            size_t h = 14695981039346656037ULL;
+            for (int k : product.letters) {
+                h = (h ^ (size_t) memo.letters[k]) * 1099511628211ULL;
+            }
+            SubMemo::Key key = {p, h};
+
+            memo.lookups++;
+            stats.lookups++;
+            auto ii = memo.entries.find(key);
+            if (ii == memo.entries.end()) {
+                SubMemo::Entry &entry = memo.entries[key];
+                entry.letters.resize(degree);
+                for (int k = 0; k < degree; k++) {
+                    entry.letters[k] = memo.letters[product.letters[k]];
+                }
+                memo.target[p] = &entry.product;
+            } else {
+                const vector<Basis> &letters = ii->second.letters;
+                int k = 0;
+                while (k < degree && letters[k] == memo.letters[product.letters[k]]) k++;
+                if (k == degree) {
+                    memo.hits++;
+                    stats.hits++;
+                    memo.value[v] = &ii->second.product;
+                    memo.target[p] = NULL;
+                    continue;
                 }
             }
-            ae2i++;
         }
-      }
-      }
-      ae1i++;
+
+        memo.needed[product.left] = 1;
+        memo.needed[product.right] = 1;
     }
 
-    return(OK);
-}
-                        
+    /* Then compute them from the letters up. */
+    for (int k = 0; k < nletters; k++) {
+        if (memo.needed[k]) {
+            memo.values[k].clear();
+            SetAE(memo.values[k], memo.letters[k], 1);
+            memo.value[k] = &memo.values[k];
+        }
+    }
 
-void Sub(const vector<Basis> &Substitution, Alg_element &Ans, const struct term_node *W, const vector<vector<int> > &Permutation_list)
-{
-    assert_not_null_nv(W);
+    for (int p = 0; p < nproducts; p++) {
+        const EvaluationPlan::Product &product = plan.products[p];
+        Alg_element *ans = memo.target[p];
 
-    if ((W->left == NULL) && (W->right == NULL)) {
-        int var_number = GetVarNumber(W->letter) - 1;
+        if (!memo.needed[nletters + p] || ans == NULL)
+            continue;
 
-        int var_occurrence_number = W->number - 1;
-        int perm_number = Permutation_list[var_number][var_occurrence_number] - 1;
+ /* This is where we use the multiplication table. */ 
 
-        Basis b = Substitution[var_number*Max_deg_var + perm_number];
+        ans->clear();
+        MultAE(*memo.value[product.left], *memo.value[product.right], *ans);
+        memo.value[nletters + p] = ans;
+    }
 
-        SetAE(Ans, b, 1); 
-    } else {
-        Alg_element left;
-        Alg_element right;
-    
-        Sub(Substitution, left, W->left, Permutation_list); 		/* TW 9/22/93 - change left to *left */
-        Sub(Substitution, right, W->right, Permutation_list); 		/* TW 9/22/93 - change right to *right */
+    const Scalar zero = S_zero();
 
- /* This is where we use the multiplication table. */ 
+    for (const EvaluationPlan::Term &term : plan.terms) {
+        const Alg_element &ae1 = *memo.value[term.left];
+        const Alg_element &ae2 = *memo.value[term.right];
 
-        MultAE(left, right, Ans);	/* TW 9/22/93 - change right to *right & left to *left */
-   }
-}
+        for (Alg_element::const_iterator ae1i = ae1.begin(); ae1i != ae1.end(); ae1i++) {
+            Scalar alpha = ae1i->second;
+            if (ae1i->first == 0 || alpha == zero)
+                continue;
+
+            for (Alg_element::const_iterator ae2i = ae2.begin(); ae2i != ae2.end(); ae2i++) {
+                Scalar beta = ae2i->second;
+                if (ae2i->first == 0 || beta == zero)
+                    continue;
+
+                Basis_pair bp;
+                bp.coef = S_mul(term.coef, S_mul(alpha, beta));
+                bp.left_basis = ae1i->first;
+                bp.right_basis = ae2i->first;
+                Local_list.push_back(bp);
+            }
+        }
+    }
 
+    return true;
+}
@@ -13,9 +13,11 @@
 #include "CreateMatrix.h"
 #include "GenerateEquations.h"
 
-int PerformSubs(const std::vector<Basis> &S, const struct polynomial *F, int Mdv, std::vector<std::vector<int> > &permutation, std::vector<Basis_pair> &Local_list);
+int PerformSubs(const GenerationContext &ctx, SubMemo &memo, const std::vector<Basis> &S, const std::vector<std::vector<int> > &permutation, std::vector<Basis_pair> &Local_list);
+void CompileIdentity(const GenerationContext &ctx, EvaluationPlan &plan);
 void AppendLocalListToTheList(const std::vector<std::vector<Basis_pair> > &Local_list, Equations &equations);
 void LocalListToEquation(const std::vector<std::vector<Basis_pair> > &Local_lists, Equation &eqn);
 void BuildPermutationLists(int nVars, const int *Dv, std::vector<std::vector<std::vector<int> > > &permutations);
+Scalar BuildDistinctPermutationLists(const std::vector<Basis> &S, int nVars, int Mdv, const int *Dv, std::vector<std::vector<std::vector<int> > > &permutations);
 
 #endif
@@ -33,6 +33,7 @@
 #include "Alg_elements.h"
 #include "Memory_routines.h"
 #include "Scalar_arithmetic.h"
+#include "Session.h"
 
 static int Absolute(int Num);
 static int Get_len(int Num);
@@ -429,12 +430,13 @@ void FreeNodes(struct term_node *Term_node)
 
 /*
  * Called from the Main(), when polynomial command is issued.
- * Polynomial is expanded using the multiplication table.
+ * Polynomial is expanded using the multiplication table of the session.
  * If the expansion collapses to 0, that means Poly is an identity.
  */
 
-int IsIdentity(const struct polynomial *Poly)
+int IsIdentity(Session &session, const struct polynomial *Poly)
 {
+    SessionScope scope(session);
     Alg_element result;
 
     assert_not_null(Poly);
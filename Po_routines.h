@@ -2,11 +2,12 @@
 #define _PO_ROUTINES_H_
 
 #include "Po_parse_exptext.h"
+#include "Session.h"
 
 void Print_poly(const struct polynomial *Poly, int Poly_len);
 int Homogeneous(struct polynomial *Poly);
 void AssignNumbersToLetters(struct polynomial *Poly);
 void DestroyPoly(struct polynomial *Poly);
-int IsIdentity(const struct polynomial *Poly);
+int IsIdentity(Session &session, const struct polynomial *Poly);
 
 #endif
@@ -3,7 +3,7 @@
 /***  AUTHOR:    David P Jacobs                                  ***/
 /***  PROGRAMMER: Sekhar Muddana                                 ***/
 /***  PUBLIC ROUTINES:                                           ***/
-/***      Scalar S_init()                                        ***/
+/***      void S_init()                                          ***/
 /***      Scalar S_zero()                                        ***/
 /***      Scalar S_one()                                         ***/
 /***      Scalar S_minus1()                                      ***/
@@ -26,24 +26,21 @@
 
 #include "Scalar_arithmetic.h"
 #include "Build_defs.h"
-#include "driver.h"
 
-Scalar Prime;
-Scalar Inverse_table[PRIME_BOUND];
-uint16_t _d_;
-uint32_t _c_;
+const ScalarField *Current_field = nullptr;
 
-void S_init() {
-    Prime = GetField();    /* Initialize the global variable Prime. */
+void S_init(ScalarField &field, Scalar prime) {
+    field.Prime = prime;
 
-    _d_ = Prime;
-    _c_ = (~(0U)) / _d_ + 1;
+    field._d_ = prime;
+    field._c_ = (~(0U)) / field._d_ + 1;
+    field._m16_ = (1U << 16) / prime;
 
-/* Initialize the global table of inverses. */
-    for (Scalar i = 1; i < Prime; i++) {
-        for (Scalar j = 1; j < Prime; j++) {
-            if (_modp(i * j) == 1) {
-                Inverse_table[i] = j;
+/* Initialize the table of inverses. */
+    for (Scalar i = 1; i < prime; i++) {
+        for (Scalar j = 1; j < prime; j++) {
+            if (_modp(field, i * j) == 1) {
+                field.Inverse_table[i] = j;
                 break;
             }
         }
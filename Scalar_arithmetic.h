@@ -1,13 +1,12 @@
 #ifndef _SCALAR_ARITHMETIC_H_
 #define _SCALAR_ARITHMETIC_H_
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 
 #include "Build_defs.h"
 
-void S_init();
-
 inline Scalar S_zero() {
     return 0;
 }
@@ -20,7 +19,7 @@ inline Scalar S_one() {
 
 #if 0
 #define Scalar_assert(x) \
-    if (x > Prime ) { \
+    if (x > S_prime() ) { \
         printf("WARNING: Scalar %d out of range.\n",x); \
         exit(1); \
      }
@@ -28,24 +27,42 @@ inline Scalar S_one() {
 #define Scalar_assert(x) {}
 #endif
 
-extern Scalar Prime;
-extern Scalar Inverse_table[PRIME_BOUND];
-extern uint16_t _d_;
-extern uint32_t _c_;
+/* The field of a session, see Session.h. */
+struct ScalarField {
+    Scalar Prime;
+    Scalar Inverse_table[PRIME_BOUND];
+    uint16_t _d_;
+    uint32_t _c_;
+    uint16_t _m16_;     /* Barrett constant of the 16-bit reduction kernels, floor(2^16 / Prime). */
+};
+
+void S_init(ScalarField &field, Scalar prime);
+
+/* The field of the current session of the thread. */
+extern const ScalarField *Current_field;
+#pragma omp threadprivate(Current_field)
+
+inline Scalar S_prime() {
+    return Current_field->Prime;
+}
 
 // With Scalar an uint8_t, x can be stored in a uint16_t, but C has
 // promoted uint8_t * uint8_t to int32_t
-inline Scalar _modp(int32_t x) {
+inline Scalar _modp(const ScalarField &field, int32_t x) {
     // return x % Prime;
-    uint32_t t = _c_ * x;
-    return ((__uint64_t) t * _d_) >> 32;
+    uint32_t t = field._c_ * x;
+    return ((__uint64_t) t * field._d_) >> 32;
     // return x % 251;
 }
 
+inline Scalar _modp(int32_t x) {
+    return _modp(*Current_field, x);
+}
+
 inline Scalar S_minus(Scalar x) {
     Scalar_assert(x);
 
-    return _modp(Prime - x);
+    return _modp(S_prime() - x);
 }
 
 inline Scalar ConvertToScalar(int i) {
@@ -76,7 +93,7 @@ inline Scalar S_inv(Scalar x) {
         printf("WARNING: Division by 0 in S_inv.\n");
         exit(1);
     } else
-        return Inverse_table[x];
+        return Current_field->Inverse_table[x];
 }
 
 #endif
@@ -0,0 +1,31 @@
+//
+// The state of one problem: its field, generators, and the type, basis and multiplication tables built for it.
+//
+
+#include "Session.h"
+#include "Mult_table.h"
+#include "Type_orbits.h"
+#include "Type_table.h"
+
+Session *Current_session = nullptr;
+
+BuildState::BuildState() : Start_time(0), Current_dimension(0), Orbits() {
+}
+
+BuildState::~BuildState() {
+}
+
+Session::Session(Scalar prime) : field(), generators(), types(), basis(), mult_table(), build() {
+    SetField(prime);
+}
+
+Session::~Session() {
+    SessionScope scope(*this);
+    build.Orbits.reset();
+    DestroyTypeTable();
+    DestroyMultTable();
+}
+
+void Session::SetField(Scalar prime) {
+    S_init(field, prime);
+}
@@ -0,0 +1,206 @@
+//
+// The state of one problem: its field, generators, and the type, basis and multiplication tables built for it.
+//
+
+#ifndef ALBERT_SESSION_H
+#define ALBERT_SESSION_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <time.h>
+
+#include "Build_defs.h"
+#include "Po_parse_exptext.h"
+#include "Scalar_arithmetic.h"
+
+class TypeOrbits;
+
+typedef struct tt_node {
+    Basis begin_basis;
+    Basis end_basis;            /* indices into Base table. */
+    Type type;
+} TT_node;
+
+typedef struct {
+    Basis left_factor;
+    Basis right_factor;
+    Name type;
+} BT_rec;
+
+typedef std::pair<Basis, Scalar> Product_term;
+
+/* The terms of one product in the multiplication table. The term of a defining product is kept in unit. */
+struct Product_terms {
+    Product_terms() : first(nullptr), last(nullptr), unit() {}
+    Product_terms(const Product_terms &) = delete;
+    Product_terms &operator=(const Product_terms &) = delete;
+
+    const Product_term *first;
+    const Product_term *last;
+    Product_term unit;
+    const Product_term *begin() const { return first; }
+    const Product_term *end() const { return last; }
+    int size() const { return last - first; }
+};
+
+// See Mult_table.cpp. The products of the basis elements of degrees d1 and d2 make up one block, a product
+// found at row b1 - row_start and column b2 - col_start of it, at the span of terms its slot gives. The
+// product b1*b2 defining a basis element n keeps no terms, its slot giving n.
+struct MultTableBlock {
+    struct Slot {
+        static const int Absent = -1;
+        static const int Defining = -2;
+
+        Slot() : begin(0), count(Absent) {}
+
+        int begin;                                  /* The basis element of a defining product. */
+        int count;
+    };
+
+    MultTableBlock() : row_start(0), col_start(0), cols(0), slots(), terms() {}
+
+    Basis row_start;
+    Basis col_start;
+    int cols;
+    std::vector<Slot> slots;                        /* Row-major, rows x cols. */
+    std::vector<Product_term> terms;
+};
+
+struct MultTable {
+    MultTable() : blocks(), basis_degree(), num_products(0), restored() {}
+
+    std::vector<std::vector<MultTableBlock> > blocks;  /* By the degrees of the factors, less 1. */
+    std::vector<Degree> basis_degree;               /* The degree of each basis element entered so far. */
+    long num_products;                              /* Not counting the defining products. */
+
+    /* Products read by restore_mult_table(), entered once the basis table is restored. */
+    std::vector<std::pair<std::pair<Basis, Basis>, std::vector<Product_term> > > restored;
+
+    /* The product B1*B2, or false if it is not in the table. */
+    bool find(Basis B1, Basis B2, Product_terms &prod) const {
+        if (B1 <= 0 || B2 <= 0 || B1 >= (Basis) basis_degree.size() || B2 >= (Basis) basis_degree.size()) {
+            return false;
+        }
+        const Degree d1 = basis_degree[B1];
+        const Degree d2 = basis_degree[B2];
+        if (d1 == 0 || d2 == 0 || d1 > (Degree) blocks.size() || d2 > (Degree) blocks[d1 - 1].size()) {
+            return false;
+        }
+        const MultTableBlock &block = blocks[d1 - 1][d2 - 1];
+        if (block.cols == 0) {
+            return false;
+        }
+        const MultTableBlock::Slot &slot = block.slots[(B1 - block.row_start) * block.cols + (B2 - block.col_start)];
+        if (slot.count == MultTableBlock::Slot::Defining) {
+            prod.unit = Product_term(slot.begin, S_one());
+            prod.first = &prod.unit;
+            prod.last = prod.first + 1;
+            return true;
+        }
+        if (slot.count == MultTableBlock::Slot::Absent) {
+            return false;
+        }
+        prod.first = block.terms.data() + slot.begin;
+        prod.last = prod.first + slot.count;
+        return true;
+    }
+};
+
+// See Type_table.cpp.
+struct TypeTableState {
+    TypeTableState() : Target_type(nullptr), Target_type_len(0), Target_type_deg(0), Type_table(), Type_table_index(),
+                       Tot_subtypes(0), Deg_to_type_table_index(), Store_block_sizes(), last_type() {}
+
+    TypeTableState(const TypeTableState &) = delete;
+    TypeTableState &operator=(const TypeTableState &) = delete;
+
+    Type Target_type;                               /* Input from higher level module. */
+    int Target_type_len;                            /* Computed from Target_type.      */
+    int Target_type_deg;                            /* Computed from Target_type.      */
+    std::vector<TT_node> Type_table;                /* Heart of the matter.            */
+    std::vector<int> Type_table_index;              /* Map type to Type_table.         */
+    int Tot_subtypes;                               /* Computed from Type_count. Size of Type_table. */
+    std::vector<int> Deg_to_type_table_index;       /* Map Degree to Type_table.*/
+    std::vector<int> Store_block_sizes;             /* To find offset into Type_table. */
+    std::vector<Degree> last_type;
+};
+
+// See Basis_table.cpp.
+struct BasisTableState {
+    BasisTableState() : Basis_table(), Deg_to_basis_table() {}
+
+    std::vector<BT_rec> Basis_table;
+    std::vector<std::pair<Basis, Basis> > Deg_to_basis_table; // maps degree to first and last indices in Basis_table associated with that degree
+};
+
+// See Generators.cpp.
+struct GeneratorState {
+    char Letter_BasisNumbers[NUM_LETTERS] = {};     /* basis  -> letter */
+    Basis BasisNumber_letters[NUM_LETTERS] = {};    /* letter -> basis  */
+};
+
+// See Build.cpp.
+struct BuildState {
+    BuildState();
+    ~BuildState();
+
+    time_t Start_time;
+    Basis Current_dimension;
+    std::unique_ptr<TypeOrbits> Orbits;
+};
+
+// Each session is independent of the others, so several problems, or one problem over several fields, can be
+// built concurrently in one process. Build(), IsIdentity() and the saving and restoring of the tables take
+// the session explicitly. The routines of the tables and of scalar arithmetic below them act on the session
+// current in the calling thread, set with a SessionScope.
+class Session {
+public:
+    explicit Session(Scalar prime);
+    ~Session();
+
+    Session(const Session &) = delete;
+    Session &operator=(const Session &) = delete;
+
+    void SetField(Scalar prime);
+
+    ScalarField field;
+    GeneratorState generators;
+    TypeTableState types;
+    BasisTableState basis;
+    MultTable mult_table;
+    BuildState build;
+};
+
+// The current session of the thread. Parallel regions acting on it name Current_session and Current_field in
+// a copyin clause, so the threads of the team act on the session of the thread starting the region.
+extern Session *Current_session;
+#pragma omp threadprivate(Current_session)
+
+inline Session &CurrentSession() {
+    return *Current_session;
+}
+
+// Make a session current in the calling thread for the lifetime of the scope.
+class SessionScope {
+public:
+    explicit SessionScope(Session &session) : saved_session(Current_session), saved_field(Current_field) {
+        Current_session = &session;
+        Current_field = &session.field;
+    }
+
+    ~SessionScope() {
+        Current_session = saved_session;
+        Current_field = saved_field;
+    }
+
+    SessionScope(const SessionScope &) = delete;
+    SessionScope &operator=(const SessionScope &) = delete;
+
+private:
+    Session *saved_session;
+    const ScalarField *saved_field;
+};
+
+#endif //ALBERT_SESSION_H
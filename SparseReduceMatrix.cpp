@@ -40,10 +40,10 @@
 #include "profile.h"
 #include "memory_usage.h"
 
-extern bool __record;
-extern int __deg;
-extern int __nn1;
-extern int __nn2;
+extern thread_local bool __record;
+extern thread_local int __deg;
+extern thread_local int __nn1;
+extern thread_local int __nn2;
 
 namespace SparseReduceMatrix_ns {
 
@@ -604,7 +604,7 @@ namespace SparseReduceMatrix_ns {
 
         /* try to knockout elements in column in the rows above */
 
-#pragma omp parallel for shared(SM, row, col, last_row) schedule(static, 50) default(none)
+#pragma omp parallel for shared(SM, row, col, last_row) schedule(static, 50) default(none) copyin(Current_field)
 //    for (int j = 0; j < (int) SM.size(); j++) {
         for (int j = 0; j < last_row; j++) {
             if (j != row) {
@@ -363,7 +363,7 @@ namespace SparseReduceMatrix2_ns {
             if (j < nRows) {
 //            SM[nextstairrow].swap(SM[j]);
                 if (nextstairrow != j) {
-#pragma omp parallel for shared(SM, i, j, nextstairrow) schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(SM, i, j, nextstairrow) schedule(dynamic, 10) default(none) copyin(Current_field)
                     for (int iii = i; iii < SM.size(); iii++) {
                         auto ii = SM.begin() + iii;
 
@@ -563,7 +563,7 @@ namespace SparseReduceMatrix2_ns {
         const auto ss = SM[col];
 
 //    printf("sr.size:%d\n", sr.size());
-#pragma omp parallel for shared(sr, nRows, row, SM, ss) schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(sr, nRows, row, SM, ss) schedule(dynamic, 10) default(none) copyin(Current_field)
         for (int j0 = 0; j0 < (int) sr.size(); j0++) {
             Scalar e = sr[j0].getElement();
             int j = sr[j0].getColumn();
@@ -298,7 +298,7 @@ namespace SparseReduceMatrix3_ns {
                 int col = ii->first.second;
                 const auto &ss = ii->second;
 
-#pragma omp parallel for shared(SM, col, row) schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(SM, col, row) schedule(dynamic, 10) default(none) copyin(Current_field)
                 for(int j=0; j<row; j++) {
                     SparseAddRow(SM, S_minus(Get_Matrix_Element3(SM, j, col)), row, j);
                 }
@@ -308,7 +308,7 @@ namespace SparseReduceMatrix3_ns {
 #else
         {
 //        int nn2 = 0;
-#pragma omp parallel for shared(SM, replay, nCols) schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(SM, replay, nCols) schedule(dynamic, 10) default(none) copyin(Current_field)
             for (int j = 0; j < SM.size(); j++) {
                 DenseRow tmp(nCols, S_zero());
                 for (const auto &ii : SM[j]) {
@@ -484,14 +484,14 @@ namespace SparseReduceMatrix3_ns {
         replay.push_back(make_pair(make_pair(row, col), SM[row]));
 
 #if 0
-#pragma omp parallel for shared(SM, row, col) schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(SM, row, col) schedule(dynamic, 10) default(none) copyin(Current_field)
         for (int j = 0; j < (int) SM.size(); j++) {
             if (j != row) {
                 SparseAddRow(SM, S_minus(Get_Matrix_Element3(SM, j, col)), row, j);
             }
         }
 #else
-#pragma omp parallel for shared(SM, row, col) schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(SM, row, col) schedule(dynamic, 10) default(none) copyin(Current_field)
         for (int j = row + 1; j < (int) SM.size(); j++) {
             Scalar e = Get_Matrix_Element3(SM, j, col);
             SparseAddRow3(S_minus(e), SM[row], SM[j]);
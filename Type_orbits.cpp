@@ -0,0 +1,259 @@
+//
+// Reuse of the solution of a type for the types it is mapped to by permuting generators.
+//
+// The identities are invariant under renaming generators, and a permutation sigma of generators of the same
+// degree in the target type maps the subtypes of the target onto themselves. It extends to an automorphism of
+// the algebra built so far, taking type r to type n = sigma(r). So the product of a basis pair (x, y) of type
+// n is the image of tau(x) tau(y), tau being the inverse of sigma, a product of type r known from the table.
+//
+// Once every pair of n has its coordinates in the basis of r, the basis of n is chosen as reducing the
+// relations would choose it, as the pairs independent of all the pairs after them. The other pairs are
+// written in terms of those, giving the relations in row canonical form for SparseExtractFromMatrix().
+//
+// A pair in no equation of n is in no relation, and reducing the equations enters it after the pairs of
+// the equations. Such pairs are not columns here either, so the basis is numbered as when reducing the
+// equations, as long as every pair of the equations is in some relation. That fails when the terms of the
+// equations on a pair cancel, as for (xy)z - (yx)z with x = y, and is checked on the representative.
+//
+
+#include <algorithm>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Type_orbits.h"
+#include "Alg_elements.h"
+#include "Basis_table.h"
+#include "Mult_table.h"
+#include "Scalar_arithmetic.h"
+#include "Type_table.h"
+
+using std::vector;
+
+TypeOrbits::TypeOrbits(Type Target_type) : classes(), representatives(), unrelated() {
+    const int len = GetTargetLen();
+
+    for (int g = 0; g < len; g++) {
+        int k = 0;
+        while (k < (int) classes.size() && Target_type[classes[k][0]] != Target_type[g]) k++;
+        if (k == (int) classes.size()) classes.push_back(vector<int>());
+        classes[k].push_back(g);
+    }
+}
+
+bool TypeOrbits::find(Name n, Name *r, vector<int> &sigma) {
+    const int len = GetTargetLen();
+
+    Type t = GetNewType();
+    NameToType(n, t);
+
+    // The orbit is given by the degrees in n of the generators of each class, in decreasing order.
+    vector<Degree> key(t, t + len);
+    for (const auto &c : classes) {
+        vector<Degree> d;
+        for (int g : c) d.push_back(t[g]);
+        std::sort(d.begin(), d.end(), std::greater<Degree>());
+        for (int k = 0; k < (int) c.size(); k++) key[c[k]] = d[k];
+    }
+
+    auto ii = representatives.find(key);
+    if (ii == representatives.end()) {
+        representatives[key] = n;
+        free(t);
+        return false;
+    }
+
+    *r = ii->second;
+    Type tr = GetNewType();
+    NameToType(*r, tr);
+
+    sigma.resize(len);
+    for (const auto &c : classes) {
+        vector<int> from(c), to(c);
+        std::stable_sort(from.begin(), from.end(), [tr](int a, int b) { return tr[a] < tr[b]; });
+        std::stable_sort(to.begin(), to.end(), [t](int a, int b) { return t[a] < t[b]; });
+        for (int k = 0; k < (int) c.size(); k++) sigma[from[k]] = to[k];
+    }
+
+    free(tr);
+    free(t);
+    return true;
+}
+
+bool TypeOrbits::relabels(Name r) const {
+    const Basis r0 = BeginBasis(r);
+    const int d = r0 != 0 ? EndBasis(r) - r0 + 1 : 0;
+
+    return d <= Max_relabel_dimension && unrelated.count(r) == 0;
+}
+
+namespace TypeOrbitsImpl {
+
+    // Images under tau of the basis elements, computed from their defining products as needed.
+    class Relabel {
+    public:
+        explicit Relabel(const vector<int> &sigma) : image(GetNextBasisTobeFilled()), done(image.size(), false) {
+            const int len = GetTargetLen();
+            vector<Basis> generator(len);
+            Type t = GetNewType();
+            for (int g = 0; g < len; g++) {
+                for (int k = 0; k < len; k++) t[k] = 0;
+                t[g] = 1;
+                generator[g] = BeginBasis(TypeToName(t));
+            }
+            free(t);
+
+            for (int g = 0; g < len; g++) {
+                SetAE(image[generator[sigma[g]]], generator[g], S_one());
+                done[generator[sigma[g]]] = true;
+            }
+        }
+
+        const Alg_element &operator()(Basis b) {
+            if (!done[b]) {
+                const Alg_element &left = (*this)(LeftFactor(b));
+                const Alg_element &right = (*this)(RightFactor(b));
+                MultAE(left, right, image[b]);
+                done[b] = true;
+            }
+            return image[b];
+        }
+
+    private:
+        vector<Alg_element> image;
+        vector<char> done;
+    };
+
+}
+
+int RelabelType(Name n, Name r, const vector<int> &sigma, SparseMatrix &SM, int *Cols,
+                vector<Unique_basis_pair> &ColtoBP) {
+    using namespace TypeOrbitsImpl;
+
+    SM.clear();
+    CreatePairUniverse(n, ColtoBP);
+    const int P = ColtoBP.size();
+
+    const Basis r0 = BeginBasis(r);
+    const int d = r0 != 0 ? EndBasis(r) - r0 + 1 : 0;
+
+    // Coordinates of the products of the pairs of n, mapped back to type r.
+    vector<Alg_element> coords(P);
+    {
+        Relabel tau(sigma);
+        for (int p = 0; p < P; p++) {
+            MultAE(tau(ColtoBP[p].left_basis), tau(ColtoBP[p].right_basis), coords[p]);
+        }
+    }
+
+    // The new basis, the pairs independent of those after them, found from the last pair on. Row k of the
+    // echelon form is rows[k * d, (k + 1) * d).
+    vector<int> basis_pairs;
+    {
+        vector<Scalar> rows;
+        rows.reserve((size_t) d * d);
+        vector<int> pivots;
+        vector<Scalar> v(d);
+        for (int p = P - 1; p >= 0 && (int) basis_pairs.size() < d; p--) {
+            std::fill(v.begin(), v.end(), S_zero());
+            for (const auto &term : coords[p]) v[term.first - r0] = term.second;
+
+            for (int k = 0; k < (int) pivots.size(); k++) {
+                const Scalar f = v[pivots[k]];
+                if (f == S_zero()) continue;
+                const Scalar m = S_minus(f);
+                const Scalar *row = &rows[(size_t) k * d];
+                for (int j = pivots[k]; j < d; j++) v[j] = S_add(v[j], S_mul(m, row[j]));
+            }
+
+            int j = 0;
+            while (j < d && v[j] == S_zero()) j++;
+            if (j == d) continue;
+
+            const Scalar inv = S_inv(v[j]);
+            for (auto &x : v) x = S_mul(x, inv);
+            rows.insert(rows.end(), v.begin(), v.end());
+            pivots.push_back(j);
+            basis_pairs.push_back(p);
+        }
+    }
+
+    if ((int) basis_pairs.size() < d) {
+        printf("Relabeling failed, %d of %d basis elements found...", (int) basis_pairs.size(), d);
+        return 0;
+    }
+
+    // Columns of the inverse of the matrix whose columns are the coordinates of the basis pairs, column j
+    // being inverse[j * d, (j + 1) * d). The augmented matrix a has rows of w = 2 d entries.
+    vector<Scalar> inverse((size_t) d * d, S_zero());
+    {
+        const int w = 2 * d;
+        vector<Scalar> a((size_t) d * w, S_zero());
+        for (int k = 0; k < d; k++) {
+            for (const auto &term : coords[basis_pairs[k]]) a[(size_t) (term.first - r0) * w + k] = term.second;
+            a[(size_t) k * w + d + k] = S_one();
+        }
+        for (int c = 0; c < d; c++) {
+            int i = c;
+            while (a[(size_t) i * w + c] == S_zero()) i++;
+            Scalar *ac = &a[(size_t) c * w];
+            if (i != c) std::swap_ranges(ac, ac + w, &a[(size_t) i * w]);
+            const Scalar inv = S_inv(ac[c]);
+            for (int j = c; j < w; j++) ac[j] = S_mul(ac[j], inv);
+            for (int i2 = 0; i2 < d; i2++) {
+                Scalar *ai = &a[(size_t) i2 * w];
+                if (i2 == c || ai[c] == S_zero()) continue;
+                const Scalar m = S_minus(ai[c]);
+                for (int j = c; j < w; j++) ai[j] = S_add(ai[j], S_mul(m, ac[j]));
+            }
+        }
+        for (int k = 0; k < d; k++) {
+            for (int j = 0; j < d; j++) inverse[(size_t) j * d + k] = a[(size_t) k * w + d + j];
+        }
+    }
+
+    // Each other pair is written in terms of the basis pairs, all after it.
+    vector<char> is_basis(P, false);
+    for (int p : basis_pairs) is_basis[p] = true;
+
+    vector<Scalar> coef(d);
+    for (int p = 0; p < P; p++) {
+        if (is_basis[p]) continue;
+
+        std::fill(coef.begin(), coef.end(), S_zero());
+        for (const auto &term : coords[p]) {
+            const Scalar *col = &inverse[(size_t) (term.first - r0) * d];
+            for (int k = 0; k < d; k++) coef[k] = S_add(coef[k], S_mul(term.second, col[k]));
+        }
+
+        SparseRow row;
+        row.push_back(Node(S_one(), p));
+        for (int k = d - 1; k >= 0; k--) {
+            if (coef[k] != S_zero()) row.push_back(Node(S_minus(coef[k]), basis_pairs[k]));
+        }
+        SM.push_back(row);
+    }
+
+    // A pair in no relation is in no equation either, and a build generating the equations enters these
+    // pairs after the others, in ProcessOtherIndependentBasis(). So only the pairs in relations are columns,
+    // in the order of the universe, which is the order of the columns of the equations.
+    vector<int> column(P, -1);
+    for (const auto &row : SM) {
+        for (const auto &node : row) column[node.getColumn()] = 0;
+    }
+    vector<Unique_basis_pair> universe;
+    universe.swap(ColtoBP);
+    for (int p = 0; p < P; p++) {
+        if (column[p] == -1) continue;
+        column[p] = ColtoBP.size();
+        ColtoBP.push_back(universe[p]);
+    }
+    *Cols = ColtoBP.size();
+
+    for (auto &row : SM) {
+        for (auto &node : row) node.setColumn(column[node.getColumn()]);
+    }
+
+    return OK;
+}
@@ -0,0 +1,49 @@
+//
+// Reuse of the solution of a type for the types it is mapped to by permuting generators.
+//
+
+#ifndef ALBERT_TYPE_ORBITS_H
+#define ALBERT_TYPE_ORBITS_H
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "Build_defs.h"
+#include "CreateMatrix.h"
+
+// Generators of the same degree in the target type can be exchanged without changing the problem, so the
+// types of each degree fall into orbits under these permutations, each solved from any one of its types.
+class TypeOrbits {
+public:
+    explicit TypeOrbits(Type Target_type);
+
+    // Whether a type of the orbit of n was seen before. If so, r is that type and sigma maps each generator
+    // of r to one of n with the same degree. Otherwise n is recorded as the representative of its orbit.
+    bool find(Name n, Name *r, std::vector<int> &sigma);
+
+    // Record that some pair in the equations of type r is in none of its relations, the terms of each
+    // equation on the pair cancelling. The relations do not tell which pairs are in the equations, so the
+    // types of the orbit of r are then built from their equations instead.
+    void note_unrelated_pairs(Name r) { unrelated.insert(r); }
+
+    // Whether the types of the orbit of r can be built from r by relabeling. The work of relabeling grows
+    // with the cube of the dimension of r, so types of dimension over Max_relabel_dimension are built from
+    // their equations, as reducing those is then no more costly.
+    bool relabels(Name r) const;
+
+    static const int Max_relabel_dimension = 256;
+
+private:
+    std::vector<std::vector<int> > classes;
+    std::map<std::vector<Degree>, Name> representatives;
+    std::set<Name> unrelated;
+};
+
+// Build the relations among all basis pairs of type n, in row canonical form, from the products of type r,
+// which is mapped to n by sigma as returned by TypeOrbits::find(). Columns are the pairs in ColtoBP, those in
+// some relation, the others being left to SparseExtractFromMatrix().
+int RelabelType(Name n, Name r, const std::vector<int> &sigma, SparseMatrix &SM, int *Cols,
+                std::vector<Unique_basis_pair> &ColtoBP);
+
+#endif //ALBERT_TYPE_ORBITS_H
@@ -38,6 +38,7 @@ using std::vector;
 #include "Basis_table.h"
 #include "Build_defs.h"
 #include "Memory_routines.h"
+#include "Session.h"
 
 static void EnterBeginBasis(int TTindex, Basis basis);
 static void InitStoreblocksizes();
@@ -53,17 +54,6 @@ static void PrintTypetable();
 static void PrintTypetableindex();
 #endif
 
-static Type Target_type = nullptr;             /* Input from higher level module. */
-static int Target_type_len = 0;                /* Computed from Target_type.      */
-static int Target_type_deg = 0;                /* Computed from Target_type.      */
-static vector<TT_node> Type_table;             /* Heart of the matter.            */
-static vector<int> Type_table_index;           /* Map type to Type_table.         */
-static int Tot_subtypes = 0;                   /* Computed from Type_count. Size of Type_table. */
-static vector<int> Deg_to_type_table_index;    /* Map Degree to Type_table.*/
-static vector<int> Store_block_sizes;          /* To find offset into Type_table. */
-
-static vector<Degree> last_type;
-
 /*******************************************************************/
 /* GLOBALS INITIALIZED:                                            */
 /*     Target_type_len -- Length of the Target_type.               */
@@ -87,27 +77,28 @@ static vector<Degree> last_type;
 /*******************************************************************/ 
 int CreateTypeTable(Type Cur_type)
 {
+    TypeTableState &tt = CurrentSession().types;
     int i = 0;
     
-    Target_type_len = 0;
+    tt.Target_type_len = 0;
     while (Cur_type[i++] != 0) {
-        Target_type_len++;
+        tt.Target_type_len++;
     }
 
     // Include +1 in length so that the above Target_type_len calculations see the trailing 0.
-    last_type = vector<Degree>(Cur_type, Cur_type + Target_type_len + 1);
+    tt.last_type = vector<Degree>(Cur_type, Cur_type + tt.Target_type_len + 1);
 
-    Target_type = GetNewType();
+    tt.Target_type = GetNewType();
 
-    for (i = 0; i < Target_type_len; i++) {
-        Target_type[i] = Cur_type[i];
+    for (i = 0; i < tt.Target_type_len; i++) {
+        tt.Target_type[i] = Cur_type[i];
     }
 
-    Target_type_deg = GetDegree(Target_type); 
+    tt.Target_type_deg = GetDegree(tt.Target_type); 
 
     InitStoreblocksizes();
 
-    vector<int> Type_count(Target_type_deg + 1, 0);
+    vector<int> Type_count(tt.Target_type_deg + 1, 0);
     FillTypecount(Type_count, 0);
 
     return InitTypetable(Type_count);
@@ -115,16 +106,18 @@ int CreateTypeTable(Type Cur_type)
 
 int GetTargetLen()
 {
-    return Target_type_len;
+    TypeTableState &tt = CurrentSession().types;
+    return tt.Target_type_len;
 }
 
 
 Type GetNewType()
 {
-    Type temp_type = (Type) Mymalloc((Target_type_len + 1) * sizeof(Degree));
+    TypeTableState &tt = CurrentSession().types;
+    Type temp_type = (Type) Mymalloc((tt.Target_type_len + 1) * sizeof(Degree));
     assert_not_null(temp_type);
 
-    for (int i = 0; i <= Target_type_len; i++) {
+    for (int i = 0; i <= tt.Target_type_len; i++) {
         temp_type[i] = 0;
     }
 
@@ -134,20 +127,22 @@ Type GetNewType()
 
 void NameToType(Name N, Type T)
 {
+    TypeTableState &tt = CurrentSession().types;
     assert_not_null_nv(T);
 
-    for (int i = 0; i < Target_type_len; i++) {
-        T[i] = Type_table[N].type[i];
+    for (int i = 0; i < tt.Target_type_len; i++) {
+        T[i] = tt.Type_table[N].type[i];
     }
 }
 
 
 void SubtractTypeName(Name n1, Name n2, Name *res_name)
 {
+    TypeTableState &tt = CurrentSession().types;
     Type temp_type = GetNewType();
 
-    for (int i = 0; i < Target_type_len; i++) {
-        temp_type[i] = Type_table[n1].type[i] - Type_table[n2].type[i];
+    for (int i = 0; i < tt.Target_type_len; i++) {
+        temp_type[i] = tt.Type_table[n1].type[i] - tt.Type_table[n2].type[i];
     }
 
     *res_name = TypeToName(temp_type);
@@ -158,10 +153,11 @@ void SubtractTypeName(Name n1, Name n2, Name *res_name)
 
 int GetDegree(Type Pntr)
 {
+    TypeTableState &tt = CurrentSession().types;
     assert_not_null(Pntr);
 
     int deg = 0;
-    for (int i = 0; i < Target_type_len; i++) {
+    for (int i = 0; i < tt.Target_type_len; i++) {
         deg += Pntr[i];
     }
 
@@ -171,20 +167,23 @@ int GetDegree(Type Pntr)
 
 int GetDegreeName(Name n)
 {
-    return GetDegree(Type_table[n].type);
+    TypeTableState &tt = CurrentSession().types;
+    return GetDegree(tt.Type_table[n].type);
 }
 
 
 Name TypeToName(const Type T)
 {
-    return Type_table_index[GetIndex(T)];
+    TypeTableState &tt = CurrentSession().types;
+    return tt.Type_table_index[GetIndex(T)];
 }
 
 
 bool IsSubtype(Name n1, Name n2)
 {
-    for (int i = 0; i < Target_type_len; i++) {
-        if (Type_table[n1].type[i] > Type_table[n2].type[i]) {
+    TypeTableState &tt = CurrentSession().types;
+    for (int i = 0; i < tt.Target_type_len; i++) {
+        if (tt.Type_table[n1].type[i] > tt.Type_table[n2].type[i]) {
             return false;
         }
     }
@@ -195,13 +194,15 @@ bool IsSubtype(Name n1, Name n2)
 
 void EnterBeginBasis(int TTindex, Basis basis)
 {
-    Type_table[TTindex].begin_basis = basis;
+    TypeTableState &tt = CurrentSession().types;
+    tt.Type_table[TTindex].begin_basis = basis;
 }
 
 
 void EnterEndBasis(int TTindex, Basis basis)
 {
-    Type_table[TTindex].end_basis = basis;
+    TypeTableState &tt = CurrentSession().types;
+    tt.Type_table[TTindex].end_basis = basis;
 }
 
 void UpdateTypeTable(Name n, Basis Begin_basis, Basis End_basis)
@@ -224,11 +225,12 @@ void UpdateTypeTable(Name n, Basis Begin_basis, Basis End_basis)
 /*******************************************************************/ 
 void InitStoreblocksizes()
 {
-    Store_block_sizes.resize(Target_type_len);
+    TypeTableState &tt = CurrentSession().types;
+    tt.Store_block_sizes.resize(tt.Target_type_len);
 
-    Store_block_sizes[Target_type_len - 1] = 1;
-    for (int i = Target_type_len - 2; i >= 0; i--) {
-        Store_block_sizes[i] = (Target_type[i+1] + 1) * Store_block_sizes[i+1]; 
+    tt.Store_block_sizes[tt.Target_type_len - 1] = 1;
+    for (int i = tt.Target_type_len - 2; i >= 0; i--) {
+        tt.Store_block_sizes[i] = (tt.Target_type[i+1] + 1) * tt.Store_block_sizes[i+1]; 
     }
 }
 
@@ -249,18 +251,19 @@ void InitStoreblocksizes()
 /*******************************************************************/ 
 void FillTypecount(vector<int> &Type_count, int Cur_scan_pos)
 {
-    if (Cur_scan_pos > Target_type_len) {    
+    TypeTableState &tt = CurrentSession().types;
+    if (Cur_scan_pos > tt.Target_type_len) {    
         int d = 0;
-        for (int i=0; i<Target_type_len; i++) {
-            d += Target_type[i];
+        for (int i=0; i<tt.Target_type_len; i++) {
+            d += tt.Target_type[i];
         }
         Type_count[d]++;
     } else {
-        for (int i = 0; i <= Target_type[Cur_scan_pos]; i++) {
-            int save = Target_type[Cur_scan_pos];
-            Target_type[Cur_scan_pos] = i;
+        for (int i = 0; i <= tt.Target_type[Cur_scan_pos]; i++) {
+            int save = tt.Target_type[Cur_scan_pos];
+            tt.Target_type[Cur_scan_pos] = i;
             FillTypecount(Type_count, Cur_scan_pos + 1);
-            Target_type[Cur_scan_pos] = save;
+            tt.Target_type[Cur_scan_pos] = save;
         }
     }
 }
@@ -284,34 +287,35 @@ void FillTypecount(vector<int> &Type_count, int Cur_scan_pos)
 /*******************************************************************/ 
 int InitTypetable(const vector<int> &Type_count)
 {
+    TypeTableState &tt = CurrentSession().types;
     int i;
 
-    Tot_subtypes = 0;
+    tt.Tot_subtypes = 0;
 
-    for (i = 0; i <= Target_type_deg; i++) {
-        Tot_subtypes += Type_count[i];
+    for (i = 0; i <= tt.Target_type_deg; i++) {
+        tt.Tot_subtypes += Type_count[i];
     }
 
-    Type_table.resize(Tot_subtypes);
+    tt.Type_table.resize(tt.Tot_subtypes);
 
-    for (i = 0; i < Tot_subtypes; i++) {
-        Type_table[i].type = GetNewType(); 
-        Type_table[i].begin_basis = 0;
-        Type_table[i].end_basis = 0;
+    for (i = 0; i < tt.Tot_subtypes; i++) {
+        tt.Type_table[i].type = GetNewType(); 
+        tt.Type_table[i].begin_basis = 0;
+        tt.Type_table[i].end_basis = 0;
     }
    
-    Deg_to_type_table_index.resize(Target_type_deg + 1);
-    Deg_to_type_table_index[0] = 0;
-    for (i = 1; i <= Target_type_deg; i++) {
-        Deg_to_type_table_index[i] = Deg_to_type_table_index[i - 1] + Type_count[i - 1];
+    tt.Deg_to_type_table_index.resize(tt.Target_type_deg + 1);
+    tt.Deg_to_type_table_index[0] = 0;
+    for (i = 1; i <= tt.Target_type_deg; i++) {
+        tt.Deg_to_type_table_index[i] = tt.Deg_to_type_table_index[i - 1] + Type_count[i - 1];
     }
 
-    Type_table_index.resize(Tot_subtypes);
+    tt.Type_table_index.resize(tt.Tot_subtypes);
     {
-      vector<int> Temp_dttt_index(Target_type_deg + 1);         /* Used to fill Type_table_index.  */
+      vector<int> Temp_dttt_index(tt.Target_type_deg + 1);         /* Used to fill Type_table_index.  */
 
-      for (i=0; i<=Target_type_deg; i++) {
-          Temp_dttt_index[i] = Deg_to_type_table_index[i];
+      for (i=0; i<=tt.Target_type_deg; i++) {
+          Temp_dttt_index[i] = tt.Deg_to_type_table_index[i];
       }
     
       FillTypetable(0, Temp_dttt_index);
@@ -323,15 +327,19 @@ int InitTypetable(const vector<int> &Type_count)
 
 void DestroyTypeTable()
 {
-    for(auto & i : Type_table) {
+    TypeTableState &tt = CurrentSession().types;
+    for(auto & i : tt.Type_table) {
         free(i.type);
     }
-    Type_table.clear();
+    tt.Type_table.clear();
+
+    tt.Deg_to_type_table_index.clear();
+    tt.Type_table_index.clear();
 
-    Deg_to_type_table_index.clear();
-    Type_table_index.clear();
+    tt.Store_block_sizes.clear();
 
-    Store_block_sizes.clear();
+    free(tt.Target_type);
+    tt.Target_type = nullptr;
 }
 
 
@@ -354,24 +362,25 @@ void DestroyTypeTable()
 /*******************************************************************/ 
 int FillTypetable(int Cur_scan_pos, vector<int> &Temp_dttt_index)
 {
-    if (Cur_scan_pos > Target_type_len) {    
+    TypeTableState &tt = CurrentSession().types;
+    if (Cur_scan_pos > tt.Target_type_len) {    
         int d = 0;
-        for (int i = 0; i < Target_type_len; i++) {
-            d += Target_type[i];
+        for (int i = 0; i < tt.Target_type_len; i++) {
+            d += tt.Target_type[i];
         }
 
-        for (int i = 0; i <= Target_type_len; i++) {
-            Type_table[Temp_dttt_index[d]].type[i] = Target_type[i];
+        for (int i = 0; i <= tt.Target_type_len; i++) {
+            tt.Type_table[Temp_dttt_index[d]].type[i] = tt.Target_type[i];
         }
 
-        Type_table_index[GetIndex(Target_type)] = Temp_dttt_index[d];
+        tt.Type_table_index[GetIndex(tt.Target_type)] = Temp_dttt_index[d];
         Temp_dttt_index[d]++;
     } else {
-        for (int i = 0; i <= Target_type[Cur_scan_pos]; i++) {
-            int save = Target_type[Cur_scan_pos];
-            Target_type[Cur_scan_pos] = i;
+        for (int i = 0; i <= tt.Target_type[Cur_scan_pos]; i++) {
+            int save = tt.Target_type[Cur_scan_pos];
+            tt.Target_type[Cur_scan_pos] = i;
             FillTypetable(Cur_scan_pos + 1, Temp_dttt_index);
-            Target_type[Cur_scan_pos] = save;
+            tt.Target_type[Cur_scan_pos] = save;
         }
     }
     return OK;
@@ -389,12 +398,13 @@ int FillTypetable(int Cur_scan_pos, vector<int> &Temp_dttt_index)
 /*******************************************************************/ 
 int GetIndex(const Type Pntr)
 {
+    TypeTableState &tt = CurrentSession().types;
     assert_not_null(Pntr);
 
     int result = 0;
 
-    for (int i = 0; i < Target_type_len; i++) {
-        result += Pntr[i] * Store_block_sizes[i];
+    for (int i = 0; i < tt.Target_type_len; i++) {
+        result += Pntr[i] * tt.Store_block_sizes[i];
     }
 
     return result;
@@ -410,8 +420,9 @@ int GetIndex(const Type Pntr)
 /*******************************************************************/ 
 Name FirstTypeDegree(Degree D)
 {
-    if ((D >= 0) && (D <= Target_type_deg)) {
-        return Deg_to_type_table_index[(int) D];
+    TypeTableState &tt = CurrentSession().types;
+    if ((D >= 0) && (D <= tt.Target_type_deg)) {
+        return tt.Deg_to_type_table_index[(int) D];
     }
 
     return -1;
@@ -427,7 +438,8 @@ Name FirstTypeDegree(Degree D)
 /*******************************************************************/ 
 Name NextTypeSameDegree(Name n)
 {
-    if (n >= (Tot_subtypes - 1)) {
+    TypeTableState &tt = CurrentSession().types;
+    if (n >= (tt.Tot_subtypes - 1)) {
         return -1;
     }
 
@@ -470,7 +482,8 @@ Basis NextBasisSameType(Basis B)
 /*******************************************************************/ 
 Basis BeginBasis(Name n)
 {
-    return Type_table[n].begin_basis;
+    TypeTableState &tt = CurrentSession().types;
+    return tt.Type_table[n].begin_basis;
 }
 
 
@@ -483,16 +496,18 @@ Basis BeginBasis(Name n)
 /*******************************************************************/ 
 Basis EndBasis(Name n)
 {
-    return Type_table[n].end_basis;
+    TypeTableState &tt = CurrentSession().types;
+    return tt.Type_table[n].end_basis;
 }
 
 void PrintType(Type Pntr, FILE *filePtr)
 {
+    TypeTableState &tt = CurrentSession().types;
     int i;
 
     assert_not_null_nv(Pntr);
 
-    for (i = 0; i < Target_type_len; i++) {
+    for (i = 0; i < tt.Target_type_len; i++) {
         fprintf(filePtr, "%d", Pntr[i]);
     }
 }
@@ -500,22 +515,24 @@ void PrintType(Type Pntr, FILE *filePtr)
 
 void PrintTypeName(Name n, FILE *filePtr)
 {
-    PrintType(Type_table[n].type, filePtr);
+    TypeTableState &tt = CurrentSession().types;
+    PrintType(tt.Type_table[n].type, filePtr);
 }
 
 
 #if 0
 void PrintTypetable()
 {
+    TypeTableState &tt = CurrentSession().types;
     int i,j;
 
     printf("Type Table: \n");
-    for (i = 0; i < Tot_subtypes; i++) {
+    for (i = 0; i < tt.Tot_subtypes; i++) {
         printf("   ");
-        for (j = 0; j < Target_type_len; j++) {
-            printf("%d", Type_table[i].type[j]);
+        for (j = 0; j < tt.Target_type_len; j++) {
+            printf("%d", tt.Type_table[i].type[j]);
         }
-        printf(" %3d %3d", Type_table[i].begin_basis, Type_table[i].end_basis);
+        printf(" %3d %3d", tt.Type_table[i].begin_basis, tt.Type_table[i].end_basis);
         printf("\n");
     }
 }
@@ -523,20 +540,22 @@ void PrintTypetable()
 
 void PrintTypetableindex()
 {
+    TypeTableState &tt = CurrentSession().types;
     int i,j;
 
     printf("Type table index entries are :\n");
-    for (i = 0; i < Tot_subtypes; i++) {
-        printf("%d\n", Type_table_index[i]);
+    for (i = 0; i < tt.Tot_subtypes; i++) {
+        printf("%d\n", tt.Type_table_index[i]);
     }
 }
 #endif
 
 bool save_type_table(FILE *f) {
-    int n = last_type.size();
+    TypeTableState &tt = CurrentSession().types;
+    int n = tt.last_type.size();
     fwrite(&n, sizeof(n), 1, f);
     if(n > 0) {
-        fwrite(&last_type[0], sizeof(last_type[0]), n, f);
+        fwrite(&tt.last_type[0], sizeof(tt.last_type[0]), n, f);
     }
 
     return true;
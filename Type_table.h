@@ -7,13 +7,10 @@
 /***  DATE WRITTEN: May 1990                                     ***/
 /*******************************************************************/
 
-#include "Build_defs.h"
+#include <stdio.h>
 
-typedef struct tt_node {
-    Basis begin_basis;
-    Basis end_basis;            /* indices into Base table. */
-    Type type;
-} TT_node; 
+#include "Build_defs.h"
+#include "Session.h"
 
 int CreateTypeTable(Type Cur_type);
 int GetTargetLen();
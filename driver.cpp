@@ -63,9 +63,10 @@ static void usage();
 static void sigCatch(int x);
 
 static const char *enhanced_version = "4.0.13";
-static const unsigned short mult_file_version = 0xabef;
-static bool save_tables(const char *filename);
-static bool restore_tables(const char *filename);
+static const unsigned short mult_file_version = 0xabf0;           /* Defining products left to the basis table. */
+static const unsigned short mult_file_version_explicit = 0xabef;  /* Still read, its defining products skipped. */
+static bool save_tables(Session &session, const char *filename);
+static bool restore_tables(Session &session, const char *filename);
 
 
 #define  NOT_PRESENT  0
@@ -178,7 +179,9 @@ int main(int argc, char *argv[])
     Command =(char*) Mymalloc(Command_len);
     Operand =(char*) Mymalloc(Operand_len);
 
-    S_init();
+    /* The problem is built in this session, current from here on. */
+    Session session(Field);
+    SessionScope scope(session);
 
     /* initialize the problem type */
     for (i = 0;i<NUM_LETTERS;i++) {
@@ -345,7 +348,7 @@ int main(int argc, char *argv[])
                  i = atoi(Operand);
                  if (Change_field(i,&Field)) {
                      printf("Field changed to %d.\n",Field);
-                     S_init();
+                     session.SetField(Field);
                      if (mtable_status == PRESENT) {
                          DestroyMultTable();
                          mtable_status = NOT_PRESENT;
@@ -385,7 +388,7 @@ int main(int argc, char *argv[])
                      break;
                  }
 
-                 if (Build(Id_queue, Target_type) == OK)
+                 if (Build(session, Id_queue, Target_type) == OK)
                      mtable_status = PRESENT;
                  else
                      mtable_status = NOT_PRESENT;
@@ -485,7 +488,7 @@ int main(int argc, char *argv[])
                  Print_poly(Cur_poly,Cur_poly_len);
                  printf("\n");
 */
-                 if (IsIdentity(Cur_poly))
+                 if (IsIdentity(session, Cur_poly))
                      printf("Polynomial is an identity.");
                  else
                      printf("Polynomial is not an identity.");
@@ -579,13 +582,13 @@ type to show */
                     printf("\n");
                     if(fn && *fn){
                         if (table == 'r') {
-                            if(!restore_tables(fn)) {
+                            if(!restore_tables(session, fn)) {
                                 printf("Unable to load tables from %s\n", fn);
                             } else {
                                 mtable_status = PRESENT;
                             }
                         } else {
-                            if(!save_tables(fn)) {
+                            if(!save_tables(session, fn)) {
                                 printf("Unable to save tables to %s\n", fn);
                             }
                         }
@@ -708,8 +711,7 @@ void Print_title()
 #endif
 }
 
-/* Called from S_init() of Scalar_arithmetic.c Used to build the inverse
- * table as a part of initialization. */
+/* The field selected by the user, that of the session built in. */
 
 Scalar GetField()
 {
@@ -780,7 +782,9 @@ void sigCatch(int)
   sigIntFlag = 1;
 }
 
-bool save_tables(const char *fn) {
+bool save_tables(Session &session, const char *fn) {
+    SessionScope scope(session);
+
     FILE *f = fopen(fn, "wb");
     if (!f) {
         printf("Unable to open %s for writing\n", fn);
@@ -796,7 +800,9 @@ bool save_tables(const char *fn) {
     return rv;
 }
 
-bool restore_tables(const char *fn) {
+bool restore_tables(Session &session, const char *fn) {
+    SessionScope scope(session);
+
     FILE *f = fopen(fn, "rb");
     if (!f) {
         printf("Unable to open %s for reading\n", fn);
@@ -805,13 +811,13 @@ bool restore_tables(const char *fn) {
 
     unsigned short v;
     fread(&v, sizeof(v), 1, f);
-    if(v != mult_file_version) {
+    if(v != mult_file_version && v != mult_file_version_explicit) {
         printf("Found incompatible file version while reading %s\n", fn);
         fclose(f);
         return false;
     }
 
-    bool rv = restore_mult_table(f) && restore_basis_table(f) && restore_type_table(f);
+    bool rv = restore_mult_table(f) && restore_basis_table(f) && restore_type_table(f) && EnterRestoredProducts();
 
     fclose(f);
 
@@ -0,0 +1,138 @@
+//
+// Fill-reducing column ordering of the equation matrix.
+//
+// A simplified form of COLAMD. Columns are eliminated greedily, by least approximate degree, on the
+// quotient graph of the matrix: rows are elements, sets of columns, and eliminating a column merges the
+// elements through it into a new element holding the union of their columns, which is the pattern the
+// pivot row has after elimination. The degree of a column is approximated by the sum of the sizes of the
+// elements through it, an upper bound of the number of columns it shares an element with.
+//
+// Once a new element would hold more than max_element columns, the remaining columns are considered dense
+// and placed last, in order of their current approximate degree. Ties keep the original, lexicographic,
+// order of the basis pairs, so the ordering is deterministic.
+//
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+#include "matrix_colorder.h"
+
+namespace MatrixColOrder {
+
+    using std::vector;
+    using std::pair;
+    using std::make_pair;
+
+    static int max_element = 1024;
+
+}
+
+void FillReducingColumnOrder(const SparseMatrix &SM, int nCols, std::vector<int> &new_of_old) {
+    using namespace MatrixColOrder;
+
+    // Elements, initially the rows, and the elements through each column.
+    vector<vector<int> > elements;
+    vector<char> alive;
+    vector<vector<int> > col_elements(nCols);
+    for (const auto &row : SM) {
+        if (row.empty()) continue;
+        int e = elements.size();
+        elements.push_back(vector<int>());
+        alive.push_back(true);
+        for (const auto &n : row) {
+            elements[e].push_back(n.getColumn());
+            col_elements[n.getColumn()].push_back(e);
+        }
+    }
+
+    // Kept up to date as elements are merged. Dead elements are left in col_elements and skipped.
+    vector<long> degree(nCols, 0);
+    for (const auto &e : elements) {
+        for (int k : e) degree[k] += e.size() - 1;
+    }
+
+    typedef pair<long, int> entry;
+    std::priority_queue<entry, vector<entry>, std::greater<entry> > queue;
+    for (int c = 0; c < nCols; c++) {
+        queue.push(make_pair(degree[c], c));
+    }
+
+    vector<char> ordered(nCols, false);
+    vector<char> mark(nCols, false);
+    vector<int> order;
+    order.reserve(nCols);
+
+    while (!queue.empty()) {
+        int c = queue.top().second;
+        long d = queue.top().first;
+        queue.pop();
+        if (ordered[c] || d != degree[c]) continue;
+
+        // Merge the elements through c.
+        vector<int> merged;
+        for (int e : col_elements[c]) {
+            if (!alive[e]) continue;
+            for (int k : elements[e]) {
+                if (k != c && !ordered[k] && !mark[k]) {
+                    mark[k] = true;
+                    merged.push_back(k);
+                }
+            }
+        }
+        for (int k : merged) mark[k] = false;
+
+        if ((int) merged.size() > max_element) break;
+
+        ordered[c] = true;
+        order.push_back(c);
+
+        for (int e : col_elements[c]) {
+            if (!alive[e]) continue;
+            alive[e] = false;
+            for (int k : elements[e]) degree[k] -= elements[e].size() - 1;
+            vector<int>().swap(elements[e]);
+        }
+        vector<int>().swap(col_elements[c]);
+
+        if (merged.empty()) continue;
+
+        int ne = elements.size();
+        std::sort(merged.begin(), merged.end());
+        elements.push_back(merged);
+        alive.push_back(true);
+
+        for (int k : merged) {
+            col_elements[k].push_back(ne);
+            degree[k] += merged.size() - 1;
+            queue.push(make_pair(degree[k], k));
+        }
+    }
+
+    // The remaining, dense, columns
+    {
+        vector<pair<long, int> > rest;
+        for (int c = 0; c < nCols; c++) {
+            if (!ordered[c]) rest.push_back(make_pair(degree[c], c));
+        }
+        std::sort(rest.begin(), rest.end());
+        for (const auto &r : rest) order.push_back(r.second);
+    }
+
+    new_of_old.resize(nCols);
+    for (int k = 0; k < nCols; k++) {
+        new_of_old[order[k]] = k;
+    }
+}
+
+void PermuteColumns(SparseMatrix &SM, const std::vector<int> &new_of_old) {
+#pragma omp parallel for schedule(dynamic, 64) shared(SM, new_of_old) default(none)
+    for (int i = 0; i < (int) SM.size(); i++) {
+        auto &row = SM[i];
+        for (auto &n : row) n.setColumn(new_of_old[n.getColumn()]);
+        std::sort(row.begin(), row.end(), [](const Node &a, const Node &b) {
+            return a.getColumn() < b.getColumn();
+        });
+    }
+}
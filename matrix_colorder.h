@@ -0,0 +1,19 @@
+//
+// Fill-reducing column ordering of the equation matrix. Experimental, used with ALBERT_COLORDER.
+//
+
+#ifndef ALBERT_MATRIX_COLORDER_H
+#define ALBERT_MATRIX_COLORDER_H
+
+#include <vector>
+
+#include "CreateMatrix.h"
+
+// Compute a column permutation of SM, new_of_old[c] being the new position of column c, that tends to
+// reduce fill during reduction. The permutation only depends on the sparsity pattern of SM.
+void FillReducingColumnOrder(const SparseMatrix &SM, int nCols, std::vector<int> &new_of_old);
+
+// Renumber the columns of SM by new_of_old, keeping the rows sorted by column.
+void PermuteColumns(SparseMatrix &SM, const std::vector<int> &new_of_old);
+
+#endif //ALBERT_MATRIX_COLORDER_H
@@ -0,0 +1,167 @@
+//
+// Reduction of the equation matrix by connected components.
+//
+// Rows and columns form a bipartite graph, with an edge for each non-zero. Row operations never mix rows of
+// different components, so the reduced row echelon form of the matrix is the union of those of its
+// components. Each component is compacted to its own columns, which keeps the order of the columns, reduced,
+// and the rows are merged back by leading column.
+//
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+#include <stdio.h>
+
+#include "matrix_components.h"
+#include "matrix_reduce_sge.h"
+#include "Build_defs.h"
+#include "Scalar_arithmetic.h"
+#include "profile.h"
+
+namespace MatrixComponents {
+
+    using std::vector;
+    using std::pair;
+    using std::make_pair;
+
+    static bool split_components = true;
+    // With the structured Gaussian elimination reducer, components with at most this many rows times columns
+    // are reduced concurrently in sparse form. Other reducers are given every component, so they are the ones
+    // that run, and checked, when selected with ALBERT_METHODS.
+    static long small_cells = 1L << 22;
+
+    static int find(vector<int> &parent, int i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+    struct Component {
+        vector<int> rows;
+        vector<int> cols;
+        SparseMatrix SM;
+        int rank;
+        int status;
+
+        Component() : rows(), cols(), SM(), rank(0), status(OK) {}
+    };
+
+}
+
+int SparseReduceByComponents(SparseMatrix &SM, int nCols, int *Rank,
+                             int (*reduce)(SparseMatrix &SM, int nCols, int *Rank)) {
+    using namespace MatrixComponents;
+
+    if (!split_components) {
+        return reduce(SM, nCols, Rank);
+    }
+
+    int nRows = SM.size();
+
+    vector<int> parent(nCols);
+    std::iota(parent.begin(), parent.end(), 0);
+    for (const auto &row : SM) {
+        if (row.empty()) continue;
+        int a = find(parent, row.front().getColumn());
+        for (const auto &n : row) {
+            int b = find(parent, n.getColumn());
+            if (a != b) {
+                parent[b] = a;
+            }
+        }
+    }
+
+    // Number the components in order of their first column, and map each column into its component.
+    vector<int> comp_of_root(nCols, -1);
+    vector<int> local_col(nCols, -1);
+    vector<Component> comps;
+    {
+        vector<char> used(nCols, false);
+        for (const auto &row : SM) {
+            for (const auto &n : row) used[n.getColumn()] = true;
+        }
+        for (int c = 0; c < nCols; c++) {
+            if (!used[c]) continue;
+            int r = find(parent, c);
+            if (comp_of_root[r] == -1) {
+                comp_of_root[r] = comps.size();
+                comps.push_back(Component());
+            }
+            auto &comp = comps[comp_of_root[r]];
+            local_col[c] = comp.cols.size();
+            comp.cols.push_back(c);
+        }
+    }
+
+    if (comps.size() <= 1) {
+        return reduce(SM, nCols, Rank);
+    }
+
+    for (int i = 0; i < nRows; i++) {
+        if (SM[i].empty()) continue;
+        comps[comp_of_root[find(parent, SM[i].front().getColumn())]].rows.push_back(i);
+    }
+
+    size_t largest = 0;
+    for (size_t k = 0; k < comps.size(); k++) {
+        auto &comp = comps[k];
+        comp.SM.resize(comp.rows.size());
+        for (size_t j = 0; j < comp.rows.size(); j++) {
+            comp.SM[j].swap(SM[comp.rows[j]]);
+            for (auto &n : comp.SM[j]) n.setColumn(local_col[n.getColumn()]);
+        }
+        if (comp.rows.size() * comp.cols.size() > comps[largest].rows.size() * comps[largest].cols.size()) {
+            largest = k;
+        }
+    }
+
+    printf("\t\tComponents: %d (largest %d x %d)\n", (int) comps.size(), (int) comps[largest].rows.size(),
+           (int) comps[largest].cols.size());
+
+    const bool sge = reduce == SparseReduceMatrix10;
+    vector<int> small;
+    vector<int> large;
+    for (int k = 0; k < (int) comps.size(); k++) {
+        if (sge && (long) comps[k].rows.size() * (long) comps[k].cols.size() <= small_cells) {
+            small.push_back(k);
+        } else {
+            large.push_back(k);
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic) shared(comps, small) default(none) copyin(Current_field)
+    for (int k = 0; k < (int) small.size(); k++) {
+        auto &comp = comps[small[k]];
+        comp.status = MatrixReduceSGE::reduce(comp.SM, comp.cols.size(), &comp.rank, -1, false);
+    }
+
+    for (int k : large) {
+        auto &comp = comps[k];
+        comp.status = reduce(comp.SM, comp.cols.size(), &comp.rank);
+    }
+
+    // Merge by leading column.
+    int status = OK;
+    vector<pair<int, SparseRow *> > order;
+    for (auto &comp : comps) {
+        if (comp.status != OK && status == OK) status = comp.status;
+        for (auto &row : comp.SM) {
+            if (row.empty()) continue;
+            for (auto &n : row) n.setColumn(comp.cols[n.getColumn()]);
+            order.push_back(make_pair(row.front().getColumn(), &row));
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    SM.clear();
+    SM.resize(nRows);
+    *Rank = order.size();
+    for (size_t j = 0; j < order.size(); j++) {
+        SM[j].swap(*order[j].second);
+    }
+
+    return status;
+}
@@ -0,0 +1,17 @@
+//
+// Reduction of the equation matrix by connected components.
+//
+
+#ifndef ALBERT_MATRIX_COMPONENTS_H
+#define ALBERT_MATRIX_COMPONENTS_H
+
+#include "CreateMatrix.h"
+
+// Split SM into the connected components of its bipartite row/column graph, reduce each independently,
+// and merge the results in leading column order, as reduce would have returned them for the whole matrix.
+// With the structured Gaussian elimination reducer, SparseReduceMatrix10, small components are reduced
+// concurrently in sparse form and the others one at a time. Any other reducer reduces every component.
+int SparseReduceByComponents(SparseMatrix &SM, int nCols, int *Rank,
+                             int (*reduce)(SparseMatrix &SM, int nCols, int *Rank));
+
+#endif //ALBERT_MATRIX_COMPONENTS_H
@@ -0,0 +1,89 @@
+//
+// Online reduced row echelon form, for rows arriving a few at a time.
+//
+// Each row is reduced as it arrives by the rows kept so far, clearing their leading columns in increasing
+// order with a dense accumulator, as the Schur complement rows of the Faugere-Lachartre reducer are. What
+// is left, if anything, becomes a new pivot row. Kept rows are only reduced by the rows kept before them,
+// so the reduced row echelon form is completed at the end by back-substitution in decreasing pivot column
+// order. Memory is bounded by the kept rows, at most the rank, rather than by the number of rows inserted.
+//
+
+#include <algorithm>
+
+#include <stdio.h>
+
+#include "matrix_online.h"
+#include "matrix_reduce_sge.h"
+#include "Scalar_arithmetic.h"
+
+OnlineEchelon::OnlineEchelon(int nCols_) : nCols(nCols_), rank_(0), final_of_col(nCols_), acc(nCols_, 0),
+                                           queued(nCols_, false), touched(), pivots() {}
+
+inline void OnlineEchelon::add(int c, Scalar v) {
+    if (!final_of_col[c].empty()) {
+        if (!queued[c]) {
+            queued[c] = true;
+            pivots.push(c);
+        }
+    } else if (acc[c] == 0) {
+        touched.push_back(c);
+    }
+    acc[c] = S_add(acc[c], v);
+}
+
+void OnlineEchelon::insert(SparseRow &r) {
+    touched.clear();
+    for (const auto &n : r) add(n.getColumn(), n.getElement());
+    SparseRow().swap(r);
+
+    // Adding kept row c only changes columns after c, so pivot columns are cleared in increasing order.
+    while (!pivots.empty()) {
+        int c = pivots.top();
+        pivots.pop();
+        queued[c] = false;
+
+        Scalar v = acc[c];
+        acc[c] = 0;
+        if (v == 0) continue;
+        Scalar s = S_minus(v);
+        const SparseRow &p = final_of_col[c];
+        for (auto it = p.begin() + 1; it != p.end(); ++it) {
+            add(it->getColumn(), S_mul(s, it->getElement()));
+        }
+    }
+
+    std::sort(touched.begin(), touched.end());
+    SparseRow x;
+    for (int c : touched) {
+        if (acc[c] != 0) x.push_back(Node(acc[c], c));
+        acc[c] = 0;
+    }
+    if (x.empty()) return;
+
+    Scalar y = S_inv(x.front().getElement());
+    if (y != 1) {
+        for (auto &n : x) n.setElement(S_mul(n.getElement(), y));
+    }
+    final_of_col[x.front().getColumn()].swap(x);
+    rank_++;
+}
+
+void OnlineEchelon::finish(SparseMatrix &SM) {
+    {
+        std::vector<int> acc2(nCols, -1);
+        std::vector<int> touched2;
+        for (int c = nCols - 1; c >= 0; c--) {
+            if (final_of_col[c].empty()) continue;
+            MatrixReduceSGE::back_substitute(final_of_col[c], final_of_col, acc2, touched2);
+        }
+    }
+
+    SM.clear();
+    SM.reserve(rank_);
+    for (int c = 0; c < nCols; c++) {
+        if (!final_of_col[c].empty()) {
+            SM.push_back(SparseRow());
+            SM.back().swap(final_of_col[c]);
+        }
+    }
+}
@@ -0,0 +1,41 @@
+//
+// Online reduced row echelon form, for rows arriving a few at a time.
+//
+
+#ifndef ALBERT_MATRIX_ONLINE_H
+#define ALBERT_MATRIX_ONLINE_H
+
+#include <vector>
+#include <queue>
+#include <functional>
+
+#include "CreateMatrix.h"
+
+class OnlineEchelon {
+public:
+    explicit OnlineEchelon(int nCols);
+
+    // Reduce r by the rows kept so far, and keep what is left of it, if anything, as a new pivot row.
+    // r is consumed.
+    void insert(SparseRow &r);
+
+    int rank() const { return rank_; }
+
+    // Move the reduced row echelon form of the rows inserted to SM, one row per pivot in column order.
+    void finish(SparseMatrix &SM);
+
+private:
+    int nCols;
+    int rank_;
+    // The kept row with each leading column, normalized, and reduced by the rows kept before it.
+    std::vector<SparseRow> final_of_col;
+
+    std::vector<Scalar> acc;
+    std::vector<char> queued;
+    std::vector<int> touched;
+    std::priority_queue<int, std::vector<int>, std::greater<int> > pivots;
+
+    inline void add(int c, Scalar v);
+};
+
+#endif //ALBERT_MATRIX_ONLINE_H
@@ -11,6 +11,7 @@
 #include "memory_usage.h"
 
 #include "matrix_reduce.h"
+#include "Scalar_arithmetic.h"
 
 namespace MatrixReduce {
     using std::vector;
@@ -27,9 +28,12 @@ namespace MatrixReduce {
     static bool use_replay = false;
 
     typedef unsigned char uint8_t;
-    static uint8_t _prime_ = 251;
-    static uint16_t _d_;
-    static uint32_t _c_;
+
+    // The field is that of the current session of the thread. Parallel regions name Current_field in a
+    // copyin clause.
+    static inline uint8_t prime() {
+        return Current_field->Prime;
+    }
 
 #define DEBUG_MATRIX 0
 
@@ -39,10 +43,7 @@ namespace MatrixReduce {
 
     inline uint8_t modp(int x) {
         if (x == 0) return 0;
-        // return x % _prime_;
-        uint32_t t = _c_ * x;
-        return ((__uint64_t) t * _d_) >> 32;
-        // return x % 251;
+        return _modp(*Current_field, x);
     }
 
     class TruncatedDenseRow {
@@ -303,14 +304,12 @@ namespace MatrixReduce {
         return false;
     }
 
-    static uint8_t _inv_table[256] = {0};
-
     inline uint8_t S_inv(uint8_t x) {
-        return _inv_table[x];
+        return Current_field->Inverse_table[x];
     }
 
     inline uint8_t S_minus(uint8_t x) {
-        return modp(_prime_ - x);
+        return modp(prime() - x);
     }
 
     inline uint8_t S_mul(uint8_t x, uint8_t y) {
@@ -411,7 +410,7 @@ namespace MatrixReduce {
         }
 
 #if 0
-#pragma omp parallel for shared(rows, s, r, c, last_row) schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(rows, s, r, c, last_row) schedule(dynamic, 10) default(none) copyin(Current_field)
         for (int j = s; j < last_row; j++) {
             if (j != r) {
                 add_row(S_minus(rows[j].element(c)), rows[r], rows[j]);
@@ -430,7 +429,7 @@ namespace MatrixReduce {
 //#pragma omp parallel for shared(rows, s, r, c, last_row, rr) schedule(dynamic, 10) default(none)
 //    int n00 = rr.size() / 16 + 1;
 //#pragma omp parallel for shared(rows, s, r, c, last_row, rr, n00) schedule(static, n00) default(none)
-#pragma omp parallel for shared(rows, s, r, c, last_row, rr) default(none)
+#pragma omp parallel for shared(rows, s, r, c, last_row, rr) default(none) copyin(Current_field)
         for (int jj = 0; jj < rr.size(); jj++) {
             int j = rr[jj];
             add_row(S_minus(rows[j].element(c)), rows[r], rows[j]);
@@ -463,21 +462,6 @@ namespace MatrixReduce {
 #endif
     }
 
-    static void set_prime(uint8_t prime) {
-        _prime_ = prime;
-        _d_ = _prime_;
-        _c_ = (~(0U)) / _d_ + 1;
-
-        for (uint8_t i = 1; i < _prime_; i++) {
-            for (uint8_t j = 1; j < _prime_; j++) {
-                if (S_mul(i, j) == 1) {
-                    _inv_table[i] = j;
-                    break;
-                }
-            }
-        }
-    }
-
     void matrix_reduce(vector<TruncatedDenseRow> &rows, int n_cols) {
         if (use_replay) replay.reserve(rows.size());
 
@@ -605,7 +589,7 @@ namespace MatrixReduce {
                     int c = ii->first.second;
                     auto &row = ii->second;
 
-#pragma omp parallel for shared(rows, r, c, row) schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(rows, r, c, row) schedule(dynamic, 10) default(none) copyin(Current_field)
                     for (int j = 0; j < r; j++) {
                         add_row(S_minus(rows[j].element(c)), row, rows[j]);
                     }
@@ -631,7 +615,7 @@ namespace MatrixReduce {
 
 #include "CreateMatrix.h"
 #include "SparseReduceMatrix.h"
-#include "driver.h" // for GetField()
+#include "Scalar_arithmetic.h" // for S_prime()
 
 int SparseReduceMatrix5(SparseMatrix &SM, int nCols, int *Rank) {
     memory_usage_init(nCols);
@@ -677,7 +661,6 @@ int SparseReduceMatrix5(SparseMatrix &SM, int nCols, int *Rank) {
 
     {
 //        Profile p2("reduce");
-        MatrixReduce::set_prime(GetField());
         MatrixReduce::matrix_reduce(rows, nCols);
     }
 
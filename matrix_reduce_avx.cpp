@@ -13,11 +13,13 @@
 #include "memory_usage.h"
 
 #include "matrix_reduce_avx.h"
+#include "matrix_reduce_pluq.h"
+#include "Scalar_arithmetic.h"
 
-extern bool __record;
-extern int __deg;
-extern int __nn1;
-extern int __nn2;
+extern thread_local bool __record;
+extern thread_local int __deg;
+extern thread_local int __nn1;
+extern thread_local int __nn2;
 
 namespace MatrixReduceAVX {
 
@@ -33,11 +35,37 @@ namespace MatrixReduceAVX {
     static bool do_shrink = true;
     static int shrink_freq = 1000;
     static bool use_replay = false;
+    // Track non-stair rows by leading column, so pivot search and knock_out do not scan all remaining rows.
+    static bool use_col_index = true;
+    // With use_col_index, collect up to panel_size pivots over consecutive columns and apply them
+    // to each affected row in a single pass.
+    static bool use_panel = true;
+    static const int panel_size = 32;
+    // With use_col_index, once the rows below the stair fill more than dense_fill of the remaining columns,
+    // finish with the dense reducer, checking every dense_check_freq columns. 0 disables the switch.
+    // SparseReduceMatrix8 uses dense_fill, and SparseReduceMatrix9 passes its own fill. SparseReduceMatrix8
+    // reduces the core left by the default structured Gaussian elimination, which is rarely dense enough to
+    // gain, so the dense phase, and the randomized compression below, are opt-in with ALBERT_METHODS=8.
+    static const double dense_fill = 0;
+    static int dense_check_freq = 64;
+    static size_t dense_max_bytes = size_t(1) << 30;
+    // In the dense phase, with at least dense_compress_ratio times more rows below the stair than columns,
+    // reduce dense_compress_extra more random combinations of them than columns instead, each row being
+    // added to dense_compress_weight of them.
+    static bool dense_compress = true;
+    static double dense_compress_ratio = 2.;
+    static int dense_compress_extra = 16;
+    static int dense_compress_weight = 2;
+    // Use the 16-bit integer kernel in add_row instead of the 32-bit float kernel.
+    static bool use_int_kernel = true;
 
     typedef unsigned char uint8_t;
-    static uint8_t _prime_ = 251;
-    static uint16_t _d_;
-    static uint32_t _c_;
+
+    // The field is that of the current session of the thread, so reductions over different fields run
+    // concurrently. Parallel regions name Current_field in a copyin clause.
+    static inline uint8_t prime() {
+        return Current_field->Prime;
+    }
 
 #define DEBUG_MATRIX 0
 
@@ -47,10 +75,7 @@ namespace MatrixReduceAVX {
 
     static inline uint8_t modp(int x) {
         if (x == 0) return 0;
-        // return x % _prime_;
-        uint32_t t = _c_ * x;
-        return ((__uint64_t) t * _d_) >> 32;
-        // return x % 251;
+        return _modp(*Current_field, x);
     }
 
     class TruncatedDenseRow {
@@ -404,14 +429,12 @@ namespace MatrixReduceAVX {
         return false;
     }
 
-    static uint8_t _inv_table[256] = {0};
-
     static inline uint8_t S_inv(uint8_t x) {
-        return _inv_table[x];
+        return Current_field->Inverse_table[x];
     }
 
     static inline uint8_t S_minus(uint8_t x) {
-        return modp(_prime_ - x);
+        return modp(prime() - x);
     }
 
     static inline uint8_t S_mul(uint8_t x, uint8_t y) {
@@ -444,9 +467,9 @@ namespace MatrixReduceAVX {
             // float x = r2.d[r2i] + s * r1.d[r1i];
             __m256 _x = _mm256_add_ps(_r2, _mm256_mul_ps(_s, _r1));
 
-            // Calculate x2 = x - int(x / _prime_) * _prime_, in two steps:
-            // float x2 = int(x / _prime_);
-            // using multiplication with 1/_prime_, avoiding far slower division.
+            // Calculate x2 = x - int(x / p) * p, in two steps:
+            // float x2 = int(x / p);
+            // using multiplication with 1/p, avoiding far slower division.
             // The rounding mode (truncate, and suppress exceptions) replicates C's truncation.
 
             // This should work...
@@ -464,13 +487,65 @@ namespace MatrixReduceAVX {
             __m256 _x2 = _mm256_round_ps(_mm256_add_ps(_mm256_set1_ps(.000008 * 4), _mm256_mul_ps(_x, _k)),
                                          _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
 
-            // x2 = x - x2 * _prime_;
+            // x2 = x - x2 * p;
             _x2 = _mm256_sub_ps(_x, _mm256_mul_ps(_x2, _p));
 
             results[ii] = _mm256_cvtps_epi32(_x2);
         }
     }
 
+    static inline __m256i avx_int_ff(const __m256i &_r2, const __m256i &_r1,
+                                     const __m256i &_s, const __m256i &_p, const __m256i &_m) {
+        // Computes (r2 + s * r1) mod p for 32 packed 8-bit values using 16-bit lanes.
+        // With r1, r2, s < p <= 251, r2 + s * r1 <= 62750, so the product and sum fit in an unsigned 16-bit lane.
+        const __m256i _z = _mm256_setzero_si256();
+
+        // Zero extend to 16-bit. unpack works within 128-bit lanes, and the matching
+        // pack below undoes the interleave, so no cross-lane permute is needed.
+        __m256i a_lo = _mm256_unpacklo_epi8(_r2, _z);
+        __m256i a_hi = _mm256_unpackhi_epi8(_r2, _z);
+        __m256i b_lo = _mm256_unpacklo_epi8(_r1, _z);
+        __m256i b_hi = _mm256_unpackhi_epi8(_r1, _z);
+
+        __m256i x_lo = _mm256_add_epi16(a_lo, _mm256_mullo_epi16(b_lo, _s));
+        __m256i x_hi = _mm256_add_epi16(a_hi, _mm256_mullo_epi16(b_hi, _s));
+
+        // Barrett reduction with m = floor(2^16 / p): q = (x * m) >> 16 underestimates x / p by at most one,
+        // so x - q * p is in [0, 2p) and a single conditional subtraction finishes the reduction.
+        // min_epu16(r, r - p) selects r - p when r >= p, since r - p wraps around when r < p.
+        __m256i q_lo = _mm256_mulhi_epu16(x_lo, _m);
+        __m256i q_hi = _mm256_mulhi_epu16(x_hi, _m);
+        __m256i r_lo = _mm256_sub_epi16(x_lo, _mm256_mullo_epi16(q_lo, _p));
+        __m256i r_hi = _mm256_sub_epi16(x_hi, _mm256_mullo_epi16(q_hi, _p));
+        r_lo = _mm256_min_epu16(r_lo, _mm256_sub_epi16(r_lo, _p));
+        r_hi = _mm256_min_epu16(r_hi, _mm256_sub_epi16(r_hi, _p));
+
+        return _mm256_packus_epi16(r_lo, r_hi);
+    }
+
+    static inline __m128i sse_int_ff(const __m128i &_r2, const __m128i &_r1,
+                                     const __m128i &_s, const __m128i &_p, const __m128i &_m) {
+        // 16 value version of avx_int_ff
+        const __m128i _z = _mm_setzero_si128();
+
+        __m128i a_lo = _mm_unpacklo_epi8(_r2, _z);
+        __m128i a_hi = _mm_unpackhi_epi8(_r2, _z);
+        __m128i b_lo = _mm_unpacklo_epi8(_r1, _z);
+        __m128i b_hi = _mm_unpackhi_epi8(_r1, _z);
+
+        __m128i x_lo = _mm_add_epi16(a_lo, _mm_mullo_epi16(b_lo, _s));
+        __m128i x_hi = _mm_add_epi16(a_hi, _mm_mullo_epi16(b_hi, _s));
+
+        __m128i q_lo = _mm_mulhi_epu16(x_lo, _m);
+        __m128i q_hi = _mm_mulhi_epu16(x_hi, _m);
+        __m128i r_lo = _mm_sub_epi16(x_lo, _mm_mullo_epi16(q_lo, _p));
+        __m128i r_hi = _mm_sub_epi16(x_hi, _mm_mullo_epi16(q_hi, _p));
+        r_lo = _mm_min_epu16(r_lo, _mm_sub_epi16(r_lo, _p));
+        r_hi = _mm_min_epu16(r_hi, _mm_sub_epi16(r_hi, _p));
+
+        return _mm_packus_epi16(r_lo, r_hi);
+    }
+
     static void add_row(uint8_t s, const TruncatedDenseRow &r1, TruncatedDenseRow &r2, bool allow_shrinking = true) {
         // r2 = r2 + s * r1
         // where -s is the value of r2 in the leading column of r1
@@ -526,9 +601,58 @@ namespace MatrixReduceAVX {
 //        }
         }
 
-        {
-            const __m256 _k = _mm256_set1_ps(1.0f / _prime_);
-            const __m256 _p = _mm256_set1_ps(_prime_);
+        if (use_int_kernel) {
+            const __m256i _s = _mm256_set1_epi16(s);
+            const __m256i _p = _mm256_set1_epi16(prime());
+            const __m256i _m = _mm256_set1_epi16(Current_field->_m16_);
+            const __m256i _z3 = _mm256_setzero_si256();
+
+            for (; r1i < r1.sz - 31; r1i += 32, r2i += 32) {
+                __m256i _r2 = _mm256_loadu_si256((__m256i const *) (r2.d + r2i));
+                __m256i _r1 = _mm256_loadu_si256((__m256i const *) (r1.d + r1i));
+
+                __m256i x = avx_int_ff(_r2, _r1, _s, _p, _m);
+
+                __m256i _c = _mm256_cmpeq_epi8(x, _z3);
+                int mask = _mm256_movemask_epi8(_c);
+                r2.nz += 32 - _mm_popcnt_u32(mask);
+
+                _mm256_storeu_si256((__m256i *) (r2.d + r2i), x);
+            }
+
+            const __m128i _s2 = _mm256_castsi256_si128(_s);
+            const __m128i _p2 = _mm256_castsi256_si128(_p);
+            const __m128i _m2 = _mm256_castsi256_si128(_m);
+            const __m128i _z2 = _mm_setzero_si128();
+
+            for (; r1i < r1.sz - 15; r1i += 16, r2i += 16) {
+                __m128i _r2 = _mm_loadu_si128((__m128i const *) (r2.d + r2i));
+                __m128i _r1 = _mm_loadu_si128((__m128i const *) (r1.d + r1i));
+
+                __m128i x = sse_int_ff(_r2, _r1, _s2, _p2, _m2);
+
+                __m128i _c = _mm_cmpeq_epi8(x, _z2);
+                int mask = _mm_movemask_epi8(_c);
+                r2.nz += 16 - _mm_popcnt_u32(mask);
+
+                _mm_storeu_si128((__m128i *) (r2.d + r2i), x);
+            }
+
+            for (; r1i < r1.sz - 7; r1i += 8, r2i += 8) {
+                __m128i _r2 = _mm_loadl_epi64((__m128i const *) (r2.d + r2i));
+                __m128i _r1 = _mm_loadl_epi64((__m128i const *) (r1.d + r1i));
+
+                __m128i x = sse_int_ff(_r2, _r1, _s2, _p2, _m2);
+
+                __m128i _c = _mm_cmpeq_epi8(x, _z2);
+                int mask = _mm_movemask_epi8(_c) & 0xff;
+                r2.nz += 8 - _mm_popcnt_u32(mask);
+
+                _mm_storel_epi64((__m128i *) (r2.d + r2i), x);
+            }
+        } else {
+            const __m256 _k = _mm256_set1_ps(1.0f / prime());
+            const __m256 _p = _mm256_set1_ps(prime());
             const __m256 _s = _mm256_set1_ps(s);
             const __m256i _z3 = _mm256_setzero_si256();
 
@@ -627,9 +751,109 @@ namespace MatrixReduceAVX {
 //    if (r2.fc > r2.sz / 2) r2.shrink();
     }
 
-    static vector<pair<pair<int, int>, TruncatedDenseRow> > replay;
+    static inline __m256i avx_mod_epi32(const __m256i &x, const __m256 &_k, const __m256i &_p) {
+        // x mod p for non-negative 32-bit lanes below 2^24, which convert to float exactly.
+        // The float quotient may be off by one in either direction, which the two corrections fix.
+        __m256i q = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(x), _k));
+        __m256i r = _mm256_sub_epi32(x, _mm256_mullo_epi32(q, _p));
+        r = _mm256_add_epi32(r, _mm256_and_si256(_p, _mm256_cmpgt_epi32(_mm256_setzero_si256(), r)));
+        r = _mm256_sub_epi32(r, _mm256_andnot_si256(_mm256_cmpgt_epi32(_p, r), _p));
+        return r;
+    }
+
+    static void add_panel(const uint8_t *panel, int span, int c0, const int *act, const uint8_t *m, int n_act,
+                          int col0, TruncatedDenseRow &x) {
+        // x = x + sum_k m[k] * panel row act[k], over columns [col0, c0 + span).
+        // panel holds the panel rows densely, row j covering columns [c0, c0 + span).
+        // Products are accumulated in 32-bit lanes, two panel rows per madd, and reduced mod p once.
+        // Each product is below 2^16, so the accumulators stay below 2^24 for panels of up to 256 rows.
+        // n_act is at most panel_size.
+
+        int xi = col0 - x.start_col;
+        int pi = col0 - c0;
+
+        x.nz = 0;
+        for (int i = x.fc; i < xi; i++) {
+            if (x.d[i]) x.nz++;
+        }
+
+        const __m256 _k = _mm256_set1_ps(1.0f / prime());
+        const __m256i _p = _mm256_set1_epi32(prime());
+        const __m128i _z = _mm_setzero_si128();
+
+        int n_pairs = (n_act + 1) / 2;
+        const uint8_t *pa[(panel_size + 1) / 2];
+        const uint8_t *pb[(panel_size + 1) / 2];
+        __m256i mm[(panel_size + 1) / 2];
+        for (int k = 0; k < n_pairs; k++) {
+            int a = 2 * k;
+            int b = a + 1 < n_act ? a + 1 : a;
+            pa[k] = panel + act[a] * span;
+            pb[k] = panel + act[b] * span;
+            mm[k] = _mm256_set1_epi32(m[a] | (a != b ? m[b] << 16 : 0));
+        }
+
+        for (; pi < span - 15; pi += 16, xi += 16) {
+            __m128i _x = _mm_loadu_si128((__m128i const *) (x.d + xi));
+            __m256i acc_lo = _mm256_cvtepu8_epi32(_x);
+            __m256i acc_hi = _mm256_cvtepu8_epi32(_mm_srli_si128(_x, 8));
+
+            for (int k = 0; k < n_pairs; k++) {
+                __m128i _a = _mm_loadu_si128((__m128i const *) (pa[k] + pi));
+                __m128i _b = _mm_loadu_si128((__m128i const *) (pb[k] + pi));
+                // Interleave to (a, b) pairs of 16-bit values, so madd forms m_a * a + m_b * b per column.
+                __m256i ab_lo = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(_a, _b));
+                __m256i ab_hi = _mm256_cvtepu8_epi16(_mm_unpackhi_epi8(_a, _b));
+                acc_lo = _mm256_add_epi32(acc_lo, _mm256_madd_epi16(ab_lo, mm[k]));
+                acc_hi = _mm256_add_epi32(acc_hi, _mm256_madd_epi16(ab_hi, mm[k]));
+            }
+
+            acc_lo = avx_mod_epi32(acc_lo, _k, _p);
+            acc_hi = avx_mod_epi32(acc_hi, _k, _p);
+
+            // packus works within 128-bit lanes, the permute restores column order.
+            __m256i w = _mm256_permute4x64_epi64(_mm256_packus_epi32(acc_lo, acc_hi), 0xd8);
+            __m128i r = _mm_packus_epi16(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1));
+
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(r, _z));
+            x.nz += 16 - _mm_popcnt_u32(mask);
+
+            _mm_storeu_si128((__m128i *) (x.d + xi), r);
+        }
+
+        const int p = prime();
+        for (; pi < span; pi++, xi++) {
+            int v = x.d[xi];
+            for (int k = 0; k < n_act; k++) {
+                v += m[k] * panel[act[k] * span + pi];
+            }
+            x.d[xi] = v % p;
+            if (x.d[xi]) x.nz++;
+        }
+
+        if (x.nz == 0) x.clear();
+
+        for (auto p = x.d + x.fc; x.fc < x.sz - 1 && *p == 0; x.fc++, p++) {
+        }
+    }
+
+    static void knock_out(vector<TruncatedDenseRow> &rows, int r, int c, const vector<int> &rr) {
+        // Reduce column c of rows rr by the pivot row r. rr must hold exactly the rows, other than r,
+        // with a non-zero value in column c.
+        uint8_t x = rows[r].element(c);
+        if (x != 1) {
+            rows[r].multiply(S_inv(x));
+        }
+
+#pragma omp parallel for shared(rows, r, c, rr) default(none) copyin(Current_field)
+        for (int jj = 0; jj < (int) rr.size(); jj++) {
+            int j = rr[jj];
+            add_row(S_minus(rows[j].element(c)), rows[r], rows[j]);
+        }
+    }
 
-    static void knock_out(vector<TruncatedDenseRow> &rows, int r, int c, int last_row) {
+    static void knock_out(vector<TruncatedDenseRow> &rows, int r, int c, int last_row,
+                          vector<pair<pair<int, int>, TruncatedDenseRow> > &replay) {
         uint8_t x = rows[r].element(c);
         if (x != 1) {
             rows[r].multiply(S_inv(x));
@@ -642,7 +866,7 @@ namespace MatrixReduceAVX {
         }
 
 #if 0
-#pragma omp parallel for shared(rows, s, r, c, last_row) schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(rows, s, r, c, last_row) schedule(dynamic, 10) default(none) copyin(Current_field)
         for (int j = s; j < last_row; j++) {
             if (j != r) {
                 add_row(S_minus(rows[j].element(c)), rows[r], rows[j]);
@@ -661,7 +885,7 @@ namespace MatrixReduceAVX {
 //#pragma omp parallel for shared(rows, s, r, c, last_row, rr) schedule(dynamic, 10) default(none)
 //    int n00 = rr.size() / 16 + 1;
 //#pragma omp parallel for shared(rows, s, r, c, last_row, rr, n00) schedule(static, n00) default(none)
-#pragma omp parallel for shared(rows, s, r, c, last_row, rr) default(none)
+#pragma omp parallel for shared(rows, s, r, c, last_row, rr) default(none) copyin(Current_field)
         for (int jj = 0; jj < rr.size(); jj++) {
             int j = rr[jj];
             add_row(S_minus(rows[j].element(c)), rows[r], rows[j]);
@@ -694,23 +918,66 @@ namespace MatrixReduceAVX {
 #endif
     }
 
-    static void set_prime(uint8_t prime) {
-        _prime_ = prime;
-        _d_ = _prime_;
-        _c_ = (~(0U)) / _d_ + 1;
+    static bool test_add_row_random(uint8_t p) {
+        // Compare add_row against scalar arithmetic on rows with random contents, lengths and start columns,
+        // exercising the 32, 16, 8 and single value paths and the start column alignment.
+        bool ok = true;
+        unsigned int seed = p;
+
+        for (int t = 0; t < 200 && ok; t++) {
+            TruncatedDenseRow A;
+            TruncatedDenseRow B;
+            int n_cols = 1 + rand_r(&seed) % 200;
+
+            A.start_col = rand_r(&seed) % n_cols;
+            B.start_col = rand_r(&seed) % n_cols;
+            A.sz = n_cols - A.start_col + 1;
+            B.sz = n_cols - B.start_col + 1;
+            A.d = new uint8_t[A.sz]();
+            B.d = new uint8_t[B.sz]();
+            for (int i = 0; i < A.sz; i++) A.d[i] = (rand_r(&seed) % 3 == 0) ? 0 : rand_r(&seed) % p;
+            for (int i = 0; i < B.sz; i++) B.d[i] = (rand_r(&seed) % 3 == 0) ? 0 : rand_r(&seed) % p;
+            A.nz = 0;
+            B.nz = 0;
+            for (int i = 0; i < A.sz; i++) if (A.d[i]) A.nz++;
+            for (int i = 0; i < B.sz; i++) if (B.d[i]) B.nz++;
+            for (; A.fc < A.sz - 1 && A.d[A.fc] == 0; A.fc++) {}
+            for (; B.fc < B.sz - 1 && B.d[B.fc] == 0; B.fc++) {}
+
+            uint8_t s = rand_r(&seed) % p;
+
+            vector<uint8_t> expected(n_cols + 1, 0);
+            for (int c = B.start_col; c <= n_cols; c++) {
+                expected[c] = (B.element(c) + s * A.element(c)) % p;
+            }
+
+            add_row(s, A, B, false);
 
-        for (uint8_t i = 1; i < _prime_; i++) {
-            for (uint8_t j = 1; j < _prime_; j++) {
-                if (S_mul(i, j) == 1) {
-                    _inv_table[i] = j;
+            int nz = 0;
+            for (int c = 0; c <= n_cols; c++) {
+                if (B.element(c) != expected[c]) {
+                    printf("random p=%d t=%d s=%d c=%d got=%d expected=%d\n", p, t, s, c, B.element(c), expected[c]);
+                    ok = false;
                     break;
                 }
+                if (expected[c]) nz++;
+            }
+            if (ok && s != 0 && B.nz != nz) {
+                printf("random p=%d t=%d nz=%d expected=%d\n", p, t, B.nz, nz);
+                ok = false;
             }
+
+            A.clear();
+            B.clear();
         }
+
+        return ok;
     }
 
     void do_tests() {
-        uint8_t saved_prime = _prime_;
+        const ScalarField *saved_field = Current_field;
+        ScalarField field;
+        bool saved_int_kernel = use_int_kernel;
 
 #if 1
         uint8_t primes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59,
@@ -722,17 +989,24 @@ namespace MatrixReduceAVX {
 #endif
 
         printf("Starting tests...\n");
+        for (int kk = 0; kk < 2; kk++)
         for (int ii = 0; ii < sizeof(primes); ii++) {
             bool no_go = false;
             uint8_t p = primes[ii];
-            printf("Testing prime %d\n", p);
-            set_prime(p);
+            use_int_kernel = kk == 0;
+            printf("Testing prime %d (%s kernel)\n", p, use_int_kernel ? "integer" : "float");
+            S_init(field, p);
+            Current_field = &field;
+
+            if (!test_add_row_random(p)) {
+                no_go = true;
+            }
 
             for (int a = 0; a < p; a++) {
                 for (int b = 0; b < p; b++) {
                     for (int s = 0; s < p; s++) {
-                        uint8_t r = (a + (s * b) % _prime_) % _prime_;
-                        uint8_t r2 = (a + s * b) % _prime_;
+                        uint8_t r = (a + (s * b) % prime()) % prime();
+                        uint8_t r2 = (a + s * b) % prime();
                         if (r != r2) {
                             printf("one_mod1 %d %d %d %d  %d %d\n", p, a, b, s, r, r2);
                         }
@@ -744,7 +1018,7 @@ namespace MatrixReduceAVX {
                 for (int b = 0; b < p; b++) {
                     for (int s = 0; s < p; s++) {
                         uint8_t r = S_add(b, S_mul(S_minus(s), a));
-                        uint8_t r2 = (b + S_minus(s) * a) % _prime_;
+                        uint8_t r2 = (b + S_minus(s) * a) % prime();
                         if (r != r2) {
                             printf("one_mod %d %d %d %d  %d %d\n", p, a, b, s, r, r2);
                         }
@@ -847,14 +1121,416 @@ namespace MatrixReduceAVX {
 //            puts("Check 3 done");
         }
 
-        set_prime(saved_prime);
+        Current_field = saved_field;
+        use_int_kernel = saved_int_kernel;
 
         puts("Checks complete");
 
         exit(1);
     }
 
-    void matrix_reduce_avx(vector<TruncatedDenseRow> &rows, int n_cols) {
+    // Copy the columns [i, i + w) of row into out.
+    static void load_dense(const TruncatedDenseRow &row, int i, int w, uint8_t *out) {
+        for (int col = std::max(i, row.start_col + row.fc); col < i + w; col++) {
+            out[col - i] = row.d[col - row.start_col];
+        }
+    }
+
+    static void store_dense(TruncatedDenseRow &row, int i, int w, const uint8_t *in) {
+        for (int col = std::max(i, row.start_col); col < i + w; col++) {
+            row.d[col - row.start_col] = in[col - i];
+        }
+
+        row.nz = 0;
+        for (int j = 0; j < row.sz; j++) {
+            if (row.d[j]) row.nz++;
+        }
+        if (row.nz == 0) {
+            row.clear();
+        } else {
+            for (row.fc = 0; row.fc < row.sz - 1 && row.d[row.fc] == 0; row.fc++) {
+            }
+        }
+    }
+
+    static bool spans(const vector<TruncatedDenseRow> &rows, const vector<int> &rest, int i, int w,
+                      const uint8_t *A, const vector<pair<int, int> > &pivots) {
+        // Whether each of the rest rows, zero before column i, is in the span of the pivot rows of A, in
+        // reduced row echelon form. x is if and only if x - sum_p x[p] A_p = 0, which is checked by its
+        // product with random vectors, each missing a row outside the span with probability 1 / p.
+        const int p = prime();
+        int trials = 0;
+        for (double miss = 1; miss > 1e-12; miss /= p) trials++;
+
+        unsigned int seed = 1;
+        vector<uint8_t> x(w);
+        vector<uint8_t> z(w);
+        for (int t = 0; t < trials; t++) {
+            // z is random outside the pivot columns, and -A_p . z in pivot column p.
+            for (int c = 0; c < w; c++) z[c] = rand_r(&seed) % p;
+            for (const auto &pv : pivots) z[pv.second] = 0;
+            for (const auto &pv : pivots) {
+                const uint8_t *a = A + (size_t) pv.first * w;
+                uint64_t acc = 0;
+                for (int c = 0; c < w; c++) acc += a[c] * z[c];
+                z[pv.second] = modp(p - acc % p);
+            }
+
+            for (int j : rest) {
+                std::fill(x.begin(), x.end(), 0);
+                load_dense(rows[j], i, w, x.data());
+                uint64_t acc = 0;
+                for (int c = 0; c < w; c++) acc += x[c] * z[c];
+                if (acc % p != 0) return false;
+            }
+        }
+
+        return true;
+    }
+
+    static bool dense_phase(vector<TruncatedDenseRow> &rows, int i, int n_cols, vector<int> &stair,
+                            vector<char> &is_stair, bool compress = true) {
+        // Reduce columns [i, n_cols) with the dense reducer. Rows below the stair lead in column i or later,
+        // and take part with the stair rows that have a non-zero value in those columns.
+        int w = n_cols - i;
+
+        vector<int> drows;
+        vector<char> is_pivot;
+        for (int j : stair) {
+            const auto &row = rows[j];
+            for (int k = std::max(i - row.start_col, row.fc); k < row.sz; k++) {
+                if (row.d[k]) {
+                    drows.push_back(j);
+                    is_pivot.push_back(true);
+                    break;
+                }
+            }
+        }
+        int n_stair = drows.size();
+        vector<int> rest;
+        for (int j = 0; j < (int) rows.size(); j++) {
+            if (!is_stair[j] && !rows[j].empty()) {
+                rest.push_back(j);
+            }
+        }
+
+        // With many more rows below the stair than columns, they are replaced by random combinations, a few
+        // more than the columns, which span the same rows with high probability.
+        int n_comp = w + dense_compress_extra;
+        compress = compress && dense_compress && rest.size() >= dense_compress_ratio * n_comp;
+        int m = n_stair + (compress ? n_comp : (int) rest.size());
+
+        if ((size_t) m * w > dense_max_bytes) {
+            return false;
+        }
+
+        printf("\n\t\tDense phase: %d x %d", n_stair + (int) rest.size(), w);
+        if (compress) printf(", compressed to %d rows", m);
+        putchar('\n');
+
+        vector<uint8_t> A((size_t) m * w, 0);
+        for (int k = 0; k < n_stair; k++) {
+            load_dense(rows[drows[k]], i, w, &A[(size_t) k * w]);
+        }
+        if (!compress) {
+            for (int j : rest) {
+                load_dense(rows[j], i, w, &A[drows.size() * w]);
+                drows.push_back(j);
+                is_pivot.push_back(false);
+            }
+        } else {
+            const int p = prime();
+            unsigned int seed = 1;
+            vector<vector<pair<int, uint8_t> > > members(n_comp);
+            for (int j : rest) {
+                for (int k = 0; k < dense_compress_weight; k++) {
+                    members[rand_r(&seed) % n_comp].push_back(make_pair(j, 1 + rand_r(&seed) % (p - 1)));
+                }
+            }
+
+            vector<uint8_t> x(w);
+            vector<uint32_t> acc(w);
+            for (int g = 0; g < n_comp; g++) {
+                std::fill(acc.begin(), acc.end(), 0);
+                int k = 0;
+                for (const auto &mb : members[g]) {
+                    std::fill(x.begin(), x.end(), 0);
+                    load_dense(rows[mb.first], i, w, x.data());
+                    for (int c = 0; c < w; c++) acc[c] += mb.second * x[c];
+                    // (p - 1)^2 < 2^16, so 2^16 - 1 rows are summed before reducing.
+                    if (++k == 65535) {
+                        for (int c = 0; c < w; c++) acc[c] %= p;
+                        k = 0;
+                    }
+                }
+                uint8_t *a = &A[(size_t) (n_stair + g) * w];
+                for (int c = 0; c < w; c++) a[c] = acc[c] % p;
+            }
+            is_pivot.resize(m, false);
+        }
+
+        vector<pair<int, int> > pivots;
+        MatrixReducePLUQ::dense_rref(A.data(), m, w, w, prime(), is_pivot, pivots);
+
+        if (compress && !spans(rows, rest, i, w, A.data(), pivots)) {
+            printf("\t\tDense phase: compressed rows do not span, retrying\n");
+            return dense_phase(rows, i, n_cols, stair, is_stair, false);
+        }
+
+        // Rows never gain values ahead of their leading column, so the results fit within the rows.
+        for (int k = 0; k < (int) drows.size(); k++) {
+            store_dense(rows[drows[k]], i, w, &A[(size_t) k * w]);
+        }
+
+        if (compress) {
+            // The compressed pivot rows take the place of the first rows below the stair, with their own
+            // storage, and the others are cleared.
+            for (int j : rest) rows[j].clear();
+            for (int k = 0; k < (int) pivots.size(); k++) {
+                auto &row = rows[rest[k]];
+                row.start_col = i;
+                row.sz = w;
+                row.d = new uint8_t[w];
+                store_dense(row, i, w, &A[(size_t) pivots[k].first * w]);
+                pivots[k].first = drows.size();
+                drows.push_back(rest[k]);
+            }
+        }
+
+        for (auto &pv : pivots) {
+            stair.push_back(drows[pv.first]);
+            is_stair[drows[pv.first]] = true;
+        }
+
+        return true;
+    }
+
+    // The first column from col on, before n_cols, where row is non-zero, or n_cols if there is none.
+    static int next_nonzero(const TruncatedDenseRow &row, int col, int n_cols) {
+        if (row.empty()) return n_cols;
+
+        int k = std::max(col - row.start_col, row.fc);
+        int end = std::min(row.sz, n_cols - row.start_col);
+        for (; k + 8 <= end; k += 8) {
+            uint64_t w;
+            memcpy(&w, row.d + k, sizeof(w));
+            if (w) break;
+        }
+        for (; k < end; k++) {
+            if (row.d[k]) return row.start_col + k;
+        }
+        return n_cols;
+    }
+
+    static void matrix_reduce_avx_col_index(vector<TruncatedDenseRow> &rows, int n_cols, double fill) {
+        // Gauss-Jordan elimination driven by a leading column index.
+        //
+        // Once column i has been processed, every row that is not a stair row has a zero in column i,
+        // so before column i is processed the non-stair rows with a non-zero in column i are exactly
+        // those with leading column i. Each non-stair row is kept in the bucket of its leading column,
+        // and its leading column only changes when it is reduced while its bucket is processed, where
+        // it is moved to the bucket of its new leading column. Pivot candidates and the non-stair part
+        // of the update set therefore come straight from the bucket.
+        //
+        // The values of the stair rows to the right of their pivot are arbitrary, so each stair row is
+        // kept in a second set of buckets, by its first non-zero in column i or later. A stair row has a
+        // non-zero in the panel columns [i, c) exactly when it is in the bucket of one of them. Its
+        // values only change when it is reduced, and then only from column i on, after which it is
+        // moved to the bucket of its first non-zero from column c on. Rows in the bucket of a column
+        // without a pivot are moved on to their next non-zero when that column is passed.
+        //
+        // Rows are not moved during the reduction. The stair rows are recorded in pivot order and the
+        // rows are placed in that order at the end.
+
+        stats s1;
+        s1.update(rows, 0, 0, n_cols, -1, true);
+
+        vector<vector<int> > buckets(n_cols + 1);
+        for (int j = 0; j < (int) rows.size(); j++) {
+            if (!rows[j].empty()) {
+                buckets[rows[j].start_col + rows[j].fc].push_back(j);
+            }
+        }
+
+        vector<vector<int> > stair_buckets(n_cols + 1);
+        vector<int> stair;
+        vector<char> is_stair(rows.size(), false);
+        vector<int> rr;
+        vector<int> pcols;
+        vector<int> prows;
+        vector<uint8_t> panel;
+
+        for (int i = 0; i < n_cols;) {
+            memory_usage_update(i);
+
+            if (buckets[i].empty()) {
+                for (int j : stair_buckets[i]) {
+                    stair_buckets[next_nonzero(rows[j], i + 1, n_cols)].push_back(j);
+                }
+                vector<int>().swap(stair_buckets[i]);
+                s1.update(rows, stair.size(), i, n_cols, 60, true);
+                i++;
+                continue;
+            }
+
+            // Collect the panel, pivots for columns i, i + 1, ..., stopping at the first column without a
+            // candidate. The rows left in the buckets of the panel columns are only reduced once the panel
+            // is complete, and may then gain a value in a later column, so the panel columns must be
+            // consecutive. Candidates for a column lead in that column, so they have zeros in the earlier
+            // panel columns. Earlier panel rows are reduced by each new pivot, keeping the panel in reduced
+            // form, so a row is cleared in all panel columns using multipliers read from the row itself.
+            pcols.clear();
+            prows.clear();
+            int c = i;
+            int max_panel = use_panel ? panel_size : 1;
+            for (; c < n_cols && (int) pcols.size() < max_panel && !buckets[c].empty(); c++) {
+                auto &bucket = buckets[c];
+
+                // Selecting the row with the least number of non-zeros tends to be best, as it tends to produce
+                // less non-zero values during reduction.
+                int k0 = 0;
+                for (int k = 1; k < (int) bucket.size(); k++) {
+                    if (rows[bucket[k]].nz < rows[bucket[k0]].nz) {
+                        k0 = k;
+                    }
+                }
+                int r = bucket[k0];
+                bucket[k0] = bucket.back();
+                bucket.pop_back();
+
+                uint8_t x = rows[r].element(c);
+                if (x != 1) {
+                    rows[r].multiply(S_inv(x));
+                }
+                for (int q : prows) {
+                    uint8_t y = rows[q].element(c);
+                    if (y != 0) {
+                        add_row(S_minus(y), rows[r], rows[q]);
+                    }
+                }
+
+                pcols.push_back(c);
+                prows.push_back(r);
+            }
+
+            rr.clear();
+            for (int pc : pcols) {
+                rr.insert(rr.end(), stair_buckets[pc].begin(), stair_buckets[pc].end());
+                vector<int>().swap(stair_buckets[pc]);
+            }
+            size_t n_stair = rr.size();
+            for (int pc : pcols) {
+                rr.insert(rr.end(), buckets[pc].begin(), buckets[pc].end());
+                vector<int>().swap(buckets[pc]);
+            }
+
+            if (pcols.size() == 1) {
+                knock_out(rows, prows[0], pcols[0], rr);
+            } else {
+                int c0 = pcols.front();
+                int span = n_cols + 1 - c0;
+                int np = pcols.size();
+
+                panel.assign((size_t) np * span, 0);
+                for (int k = 0; k < np; k++) {
+                    const auto &row = rows[prows[k]];
+                    for (int col = row.start_col + row.fc; col <= n_cols; col++) {
+                        panel[(size_t) k * span + col - c0] = row.d[col - row.start_col];
+                    }
+                }
+
+#pragma omp parallel for shared(rows, rr, pcols, prows, panel, span, c0, np) default(none) copyin(Current_field)
+                for (int jj = 0; jj < (int) rr.size(); jj++) {
+                    auto &row = rows[rr[jj]];
+                    int act[panel_size];
+                    uint8_t m[panel_size];
+                    int n_act = 0;
+                    for (int k = 0; k < np; k++) {
+                        uint8_t y = row.element(pcols[k]);
+                        if (y != 0) {
+                            act[n_act] = k;
+                            m[n_act] = S_minus(y);
+                            n_act++;
+                        }
+                    }
+
+                    if (n_act == 1) {
+                        add_row(m[0], rows[prows[act[0]]], row);
+                    } else if (n_act > 1) {
+                        add_panel(panel.data(), span, c0, act, m, n_act, pcols[act[0]], row);
+                    }
+                }
+            }
+
+            stair.insert(stair.end(), prows.begin(), prows.end());
+            for (int r : prows) is_stair[r] = true;
+
+            // The reduced stair rows, and the new ones, are zero in the panel columns other than their pivot.
+            for (size_t k = 0; k < n_stair; k++) {
+                int j = rr[k];
+                stair_buckets[next_nonzero(rows[j], c, n_cols)].push_back(j);
+            }
+            for (int r : prows) {
+                stair_buckets[next_nonzero(rows[r], c, n_cols)].push_back(r);
+            }
+
+            // The reduced non-stair rows now lead in a later column, or are empty.
+            for (size_t k = n_stair; k < rr.size(); k++) {
+                int j = rr[k];
+                if (!rows[j].empty()) {
+                    buckets[rows[j].start_col + rows[j].fc].push_back(j);
+                }
+            }
+
+            // Shrink if a multiple of shrink_freq is among the panel columns.
+            if (do_shrink && (i + shrink_freq - 1) / shrink_freq * shrink_freq < c) {
+                for (int j = 0; j < (int) rows.size(); j++) {
+                    auto &r2 = rows[j];
+                    if (r2.fc > r2.sz / 2) r2.shrink();
+                }
+            }
+
+            s1.update(rows, stair.size(), c - 1, n_cols, 60, true);
+
+            if (fill > 0 && c < n_cols && i / dense_check_freq != c / dense_check_freq) {
+                size_t nz = 0;
+                size_t n = 0;
+                for (int j = 0; j < (int) rows.size(); j++) {
+                    if (!is_stair[j] && !rows[j].empty()) {
+                        nz += rows[j].nz;
+                        n++;
+                    }
+                }
+                if (n > 0 && nz >= fill * n * (n_cols - c) && dense_phase(rows, c, n_cols, stair, is_stair)) {
+                    break;
+                }
+            }
+
+            i = c;
+        }
+
+        {
+            // Place the stair rows first, in pivot order, followed by the remaining, now empty, rows.
+            vector<TruncatedDenseRow> tmp;
+            tmp.reserve(rows.size());
+            for (int j : stair) tmp.push_back(rows[j]);
+            for (int j = 0; j < (int) rows.size(); j++) {
+                if (!is_stair[j]) tmp.push_back(rows[j]);
+            }
+            rows.swap(tmp);
+        }
+
+        s1.update(rows, stair.size(), n_cols, n_cols, -1, true);
+        putchar('\n');
+    }
+
+    void matrix_reduce_avx(vector<TruncatedDenseRow> &rows, int n_cols, double fill) {
+        if (use_col_index && !use_replay) {
+            matrix_reduce_avx_col_index(rows, n_cols, fill);
+            return;
+        }
+
+        vector<pair<pair<int, int>, TruncatedDenseRow> > replay;
         if (use_replay) replay.reserve(rows.size());
 
         if (do_sort) sort(rows.begin(), rows.end(), TDR_sort);
@@ -931,7 +1607,7 @@ namespace MatrixReduceAVX {
 #endif
 
 
-                knock_out(rows, nextstairrow, i, last_row);
+                knock_out(rows, nextstairrow, i, last_row, replay);
                 for (; last_row > 0; last_row--) {
                     if (!rows[last_row - 1].empty()) {
                         break;
@@ -996,7 +1672,7 @@ namespace MatrixReduceAVX {
                     int c = ii->first.second;
                     auto &row = ii->second;
 
-#pragma omp parallel for shared(rows, r, c, row) schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(rows, r, c, row) schedule(dynamic, 10) default(none) copyin(Current_field)
                     for (int j = 0; j < r; j++) {
                         add_row(S_minus(rows[j].element(c)), row, rows[j]);
                     }
@@ -1004,7 +1680,6 @@ namespace MatrixReduceAVX {
                     row.clear();
                 }
             }
-            replay.clear();
         }
 
         s1.update(rows, nextstairrow, n_cols, n_cols, -1, true);
@@ -1025,10 +1700,26 @@ namespace MatrixReduceAVX {
 
 #include "CreateMatrix.h"
 #include "SparseReduceMatrix.h"
-#include "driver.h" // for GetField()
+#include "Scalar_arithmetic.h" // for S_prime()
+
+static int SparseReduceMatrixAVX(SparseMatrix &SM, int nCols, int *Rank, double fill);
+
+int SparseReduceMatrix9(SparseMatrix &SM, int nCols, int *Rank) {
+    // SparseReduceMatrix8, finishing with the dense reducer once the remaining rows fill
+    // 30% of the remaining columns.
+    Profile p1("SparseReduceMatrix9");
+
+    return SparseReduceMatrixAVX(SM, nCols, Rank, .3);
+}
 
 int SparseReduceMatrix8(SparseMatrix &SM, int nCols, int *Rank) {
-//    MatrixReduceAVX::do_tests();
+    return SparseReduceMatrixAVX(SM, nCols, Rank, MatrixReduceAVX::dense_fill);
+}
+
+static int SparseReduceMatrixAVX(SparseMatrix &SM, int nCols, int *Rank, double fill) {
+    if (getenv("ALBERT_AVX_TESTS")) {
+        MatrixReduceAVX::do_tests();
+    }
 
     memory_usage_init(nCols);
 
@@ -1073,8 +1764,7 @@ int SparseReduceMatrix8(SparseMatrix &SM, int nCols, int *Rank) {
 
     {
 //        Profile p2("reduce");
-        MatrixReduceAVX::set_prime(GetField());
-        MatrixReduceAVX::matrix_reduce_avx(rows, nCols);
+        MatrixReduceAVX::matrix_reduce_avx(rows, nCols, fill);
     }
 
     *Rank = 0;
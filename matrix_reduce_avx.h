@@ -10,4 +10,6 @@
 
 int SparseReduceMatrix8(SparseMatrix &SM, int nCols, int *Rank);
 
+int SparseReduceMatrix9(SparseMatrix &SM, int nCols, int *Rank);
+
 #endif //ALBERT_MATRIX_REDUCE_H
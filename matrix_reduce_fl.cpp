@@ -0,0 +1,193 @@
+//
+// Faugere-Lachartre style block reduction of type matrices.
+//
+// One row per distinct leading column is chosen as a pivot, the one with the fewest non-zeros. Permuting
+// the pivot rows to the top and the pivot columns to the left gives the block form
+//
+//     [ A B ]
+//     [ C D ]
+//
+// with A upper triangular with a non-zero diagonal. Every other row leads in a pivot column, so each is
+// reduced against the pivot rows, in increasing column order, leaving a row of the Schur complement
+// D - C A^-1 B. Those rows are independent of each other and are computed in parallel. The Schur complement
+// only involves the non-pivot columns, so it is compacted to them and reduced by SparseReduceMatrix8, after
+// which the pivot rows are back-substituted in decreasing pivot column order.
+//
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+#include <stdio.h>
+
+#include "matrix_reduce_fl.h"
+#include "matrix_reduce_avx.h"
+#include "matrix_reduce_sge.h"
+#include "Build_defs.h"
+#include "Scalar_arithmetic.h"
+#include "profile.h"
+
+namespace MatrixReduceFL {
+
+    using std::vector;
+    using std::pair;
+    using std::make_pair;
+
+    static void normalize(SparseRow &r) {
+        Scalar x = r.front().getElement();
+        if (x != 1) {
+            Scalar y = S_inv(x);
+            for (auto &n : r) n.setElement(S_mul(n.getElement(), y));
+        }
+    }
+
+    class SchurRow {
+    public:
+        explicit SchurRow(int nCols) : acc(nCols, 0), queued(nCols, false), touched(), pivots() {}
+
+        // Reduce x by the pivot rows, leaving only non-pivot columns.
+        void reduce(SparseRow &x, const vector<int> &pivot_of_col, const SparseMatrix &SM) {
+            touched.clear();
+            for (const auto &n : x) add(n.getColumn(), n.getElement(), pivot_of_col);
+
+            // Adding pivot row c only changes columns after c, so pivot columns are cleared in increasing order.
+            while (!pivots.empty()) {
+                int c = pivots.top();
+                pivots.pop();
+                queued[c] = false;
+
+                Scalar v = acc[c];
+                if (v == 0) continue;
+                Scalar s = S_minus(v);
+                for (const auto &n : SM[pivot_of_col[c]]) {
+                    add(n.getColumn(), S_mul(s, n.getElement()), pivot_of_col);
+                }
+                acc[c] = 0;
+            }
+
+            std::sort(touched.begin(), touched.end());
+            x.clear();
+            for (int c : touched) {
+                if (acc[c] != 0) x.push_back(Node(acc[c], c));
+                acc[c] = 0;
+            }
+        }
+
+    private:
+        vector<Scalar> acc;
+        vector<char> queued;
+        vector<int> touched;
+        std::priority_queue<int, vector<int>, std::greater<int> > pivots;
+
+        inline void add(int c, Scalar v, const vector<int> &pivot_of_col) {
+            if (pivot_of_col[c] != -1) {
+                if (!queued[c]) {
+                    queued[c] = true;
+                    pivots.push(c);
+                }
+            } else if (acc[c] == 0) {
+                touched.push_back(c);
+            }
+            acc[c] = S_add(acc[c], v);
+        }
+    };
+
+}
+
+int SparseReduceMatrix11(SparseMatrix &SM, int nCols, int *Rank) {
+    using namespace MatrixReduceFL;
+
+    Profile p1("SparseReduceMatrix11");
+
+    int nRows = SM.size();
+
+    // A: the row with the fewest non-zeros for each leading column
+    vector<int> pivot_of_col(nCols, -1);
+    for (int i = 0; i < nRows; i++) {
+        if (SM[i].empty()) continue;
+        int c = SM[i].front().getColumn();
+        if (pivot_of_col[c] == -1 || SM[i].size() < SM[pivot_of_col[c]].size()) {
+            pivot_of_col[c] = i;
+        }
+    }
+
+    vector<char> is_pivot(nRows, false);
+    vector<int> others;
+    for (int c = 0; c < nCols; c++) {
+        if (pivot_of_col[c] != -1) {
+            is_pivot[pivot_of_col[c]] = true;
+            normalize(SM[pivot_of_col[c]]);
+        }
+    }
+    for (int i = 0; i < nRows; i++) {
+        if (!SM[i].empty() && !is_pivot[i]) others.push_back(i);
+    }
+
+    // D - C A^-1 B, a row at a time
+#pragma omp parallel shared(SM, nCols, pivot_of_col, others) default(none) copyin(Current_field)
+    {
+        SchurRow sr(nCols);
+#pragma omp for schedule(dynamic, 16)
+        for (int k = 0; k < (int) others.size(); k++) {
+            sr.reduce(SM[others[k]], pivot_of_col, SM);
+        }
+    }
+
+    // Compact the Schur complement to the non-pivot columns.
+    vector<int> col_map(nCols, -1);
+    vector<int> col_unmap;
+    for (int c = 0; c < nCols; c++) {
+        if (pivot_of_col[c] == -1) {
+            col_map[c] = col_unmap.size();
+            col_unmap.push_back(c);
+        }
+    }
+
+    SparseMatrix D;
+    for (int i : others) {
+        if (SM[i].empty()) continue;
+        D.push_back(SparseRow());
+        D.back().swap(SM[i]);
+        for (auto &n : D.back()) n.setColumn(col_map[n.getColumn()]);
+    }
+
+    printf("\t\tFL: A %d x %d, D %d x %d\n", nCols - (int) col_unmap.size(), nCols, (int) D.size(),
+           (int) col_unmap.size());
+
+    vector<SparseRow> final_of_col(nCols);
+
+    if (!D.empty()) {
+        int d_rank = 0;
+        SparseReduceMatrix8(D, col_unmap.size(), &d_rank);
+        for (auto &row : D) {
+            if (row.empty()) continue;
+            for (auto &n : row) n.setColumn(col_unmap[n.getColumn()]);
+            int c = row.front().getColumn();
+            final_of_col[c].swap(row);
+        }
+        D.clear();
+    }
+
+    {
+        vector<int> acc(nCols, -1);
+        vector<int> touched;
+        for (int c = nCols - 1; c >= 0; c--) {
+            if (pivot_of_col[c] == -1) continue;
+            SparseRow &r = SM[pivot_of_col[c]];
+            MatrixReduceSGE::back_substitute(r, final_of_col, acc, touched);
+            final_of_col[c].swap(r);
+        }
+    }
+
+    SM.clear();
+    SM.resize(nRows);
+    *Rank = 0;
+    for (int c = 0; c < nCols; c++) {
+        if (!final_of_col[c].empty()) {
+            SM[(*Rank)++].swap(final_of_col[c]);
+        }
+    }
+
+    return 1;
+}
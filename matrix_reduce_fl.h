@@ -0,0 +1,12 @@
+//
+// Faugere-Lachartre style block reduction of type matrices.
+//
+
+#ifndef ALBERT_MATRIX_REDUCE_FL_H
+#define ALBERT_MATRIX_REDUCE_FL_H
+
+#include "CreateMatrix.h"
+
+int SparseReduceMatrix11(SparseMatrix &SM, int nCols, int *Rank);
+
+#endif //ALBERT_MATRIX_REDUCE_FL_H
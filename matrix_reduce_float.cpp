@@ -12,6 +12,7 @@
 #include "memory_usage.h"
 
 #include "matrix_reduce_float.h"
+#include "Scalar_arithmetic.h"
 
 namespace MatrixReduceFloat {
     using std::vector;
@@ -21,7 +22,12 @@ namespace MatrixReduceFloat {
     using std::make_pair;
     using std::min;
 
-    static float _prime_ = 251;
+    // The field is that of the current session of the thread. Parallel regions name Current_field in a
+    // copyin clause.
+    static inline float prime() {
+        return Current_field->Prime;
+    }
+
     static const int alignment = 256 / 8; // AVX
 
     static bool do_sort = true;
@@ -36,7 +42,7 @@ namespace MatrixReduceFloat {
 
     inline float modp(float x) {
 //    return x == 0 ? 0 : x % _prime_;
-        return x == 0 ? 0 : x - int(float(x) / float(_prime_)) * _prime_;
+        return x == 0 ? 0 : x - int(float(x) / float(prime())) * prime();
 
 //    if (x == 0) return 0;
 //    uint8_t rv = x - int(float(x) / float(_prime_)) * _prime_;
@@ -172,14 +178,12 @@ namespace MatrixReduceFloat {
         return false;
     }
 
-    static float _inv_table[256] = {0};
-
     inline float S_inv(float x) {
-        return _inv_table[int(x)];
+        return Current_field->Inverse_table[int(x)];
     }
 
     inline float S_minus(float x) {
-        return modp(_prime_ - x);
+        return modp(prime() - x);
     }
 
     inline float S_mul(float x, float y) {
@@ -312,7 +316,7 @@ namespace MatrixReduceFloat {
         int a = r2i;
         for (; r1i < r1.sz; r1i++, r2i++) {
             float x = r2.d[r2i] + s * r1.d[r1i];
-            r2.d[r2i] = x - int(x / _prime_) * _prime_;
+            r2.d[r2i] = x - int(x / prime()) * prime();
         }
         for (; a < r2.sz; a++) {
             if (r2.d[a] != 0) r2.nz++;
@@ -326,7 +330,7 @@ namespace MatrixReduceFloat {
         for (int i=0; i<nn; i++, r1i++, r2i++) {
     //        r2.d[r2i] = modp(r2.d[r2i] + s * r1.d[r1i]);
             float x = r2.d[r2i] + s * r1.d[r1i];
-            r2.d[r2i] = x - int(x / _prime_) * _prime_;
+            r2.d[r2i] = x - int(x / prime()) * prime();
         }
 #endif
 #if 0
@@ -335,14 +339,14 @@ namespace MatrixReduceFloat {
         for (int i=0; i<nn; i++, r1i++, r2i++) {
     //        r2.d[r2i] = modp(r2.d[r2i] + s * r1.d[r1i]);
             float x = r2.d[r2i] + s * r1.d[r1i];
-            r2.d[r2i] = x - int(x / _prime_) * _prime_;
+            r2.d[r2i] = x - int(x / prime()) * prime();
         }
         }
 #endif
 
-        const __m256 _k = _mm256_set1_ps(1.0f / _prime_);
+        const __m256 _k = _mm256_set1_ps(1.0f / prime());
         //__m256i _p = _mm256_set1_epi32(_prime_);
-        const __m256 _p = _mm256_set1_ps(_prime_);
+        const __m256 _p = _mm256_set1_ps(prime());
         const __m256 _s = _mm256_set1_ps(s);
         const __m256 _z = _mm256_set1_ps(0);
 
@@ -436,7 +440,7 @@ namespace MatrixReduceFloat {
         }
 
         int si = use_replay ? r + 1 : 0;
-#pragma omp parallel for shared(rows, r, c, last_row, si) schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(rows, r, c, last_row, si) schedule(dynamic, 10) default(none) copyin(Current_field)
         for (int j = si; j < last_row; j++) {
             if (j != r) {
                 add_row(S_minus(rows[j].element(c)), rows[r], rows[j]);
@@ -444,19 +448,6 @@ namespace MatrixReduceFloat {
         }
     }
 
-    static void set_prime(uint8_t prime) {
-        _prime_ = prime;
-
-        for (uint8_t i = 1; i < int(prime); i++) {
-            for (uint8_t j = 1; j < int(prime); j++) {
-                if (S_mul(i, j) == 1) {
-                    _inv_table[i] = j;
-                    break;
-                }
-            }
-        }
-    }
-
     void matrix_reduce_float(vector<TruncatedDenseRow2> &rows, int n_cols) {
         if (use_replay) {
             replay.clear();
@@ -549,7 +540,7 @@ namespace MatrixReduceFloat {
                     int c = ii->first.second;
                     const auto &row = ii->second;
 
-#pragma omp parallel for shared(rows, r, c, row) schedule(dynamic, 10) default(none)
+#pragma omp parallel for shared(rows, r, c, row) schedule(dynamic, 10) default(none) copyin(Current_field)
                     for (int j = 0; j < r; j++) {
                         add_row(S_minus(rows[j].element(c)), row, rows[j]);
                     }
@@ -569,7 +560,7 @@ namespace MatrixReduceFloat {
 
 #include "CreateMatrix.h"
 #include "SparseReduceMatrix.h"
-#include "driver.h" // for GetField()
+#include "Scalar_arithmetic.h" // for S_prime()
 
 int SparseReduceMatrix6(SparseMatrix &SM, int nCols, int *Rank) {
     memory_usage_init(nCols);
@@ -627,7 +618,6 @@ int SparseReduceMatrix6(SparseMatrix &SM, int nCols, int *Rank) {
 
     {
 //        Profile p2("reduce");
-        MatrixReduceFloat::set_prime(GetField());
         MatrixReduceFloat::matrix_reduce_float(rows, nCols);
     }
 
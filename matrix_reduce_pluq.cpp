@@ -0,0 +1,345 @@
+//
+// Dense reduced row echelon form over GF(p) with matrix product trailing updates.
+//
+// The columns are processed recursively. The left part of a column range is reduced first, which selects
+// pivot rows pi and pivot columns q. As the reduced row echelon form restricted to the left part is unique,
+// the effect of that reduction on any other column is fixed by the left part before it was reduced: with
+// S = A[pi, q] and the multipliers M = A[others, q], taken before the reduction,
+//
+//     A[pi, right] = S^-1 A[pi, right]
+//     A[others, right] = A[others, right] - M A[pi, right]
+//
+// so the right part is updated with two matrix products and then reduced in turn. The products are
+// computed in double precision with FMA, reducing mod p only once per product, as the k products of
+// values below 251 sum to well below 2^53.
+//
+// Column ranges wider than panel_width split off a panel of that width, so S stays small enough to be
+// inverted directly. Narrower ranges are halved down to base_width columns, which are reduced a row at a time.
+//
+
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "matrix_reduce_pluq.h"
+
+namespace MatrixReducePLUQ {
+
+    using std::vector;
+    using std::pair;
+    using std::min;
+
+    typedef unsigned char uint8_t;
+
+    static int panel_width = 64;
+    static int base_width = 8;
+    // Column chunk of the trailing update, bounding the size of the double precision copy of the pivot rows.
+    static int chunk_width = 2048;
+
+    // Tile sizes of the matrix product.
+    static const int gemm_mc = 64;
+    static const int gemm_nc = 256;
+
+    class Dense {
+    public:
+        Dense(uint8_t *A_, int m_, int n_, int lda_, uint8_t p_, vector<char> &is_pivot_,
+              vector<pair<int, int> > &pivots_) :
+                A(A_), m(m_), n(n_), lda(lda_), p(p_), c(0), is_pivot(is_pivot_), pivots(pivots_) {
+            c = (~(0U)) / p + 1;
+
+            memset(inv_table, 0, sizeof(inv_table));
+            for (int i = 1; i < p; i++) {
+                for (int j = 1; j < p; j++) {
+                    if (i * j % p == 1) {
+                        inv_table[i] = j;
+                        break;
+                    }
+                }
+            }
+        }
+
+        void rref() {
+            rref_cols(0, n);
+        }
+
+    private:
+        uint8_t *A;
+        int m;
+        int n;
+        int lda;
+        uint8_t p;
+        uint32_t c;
+        uint8_t inv_table[256];
+        vector<char> &is_pivot;
+        vector<pair<int, int> > &pivots;
+
+        inline uint8_t *row(int i) const { return A + (size_t) i * lda; }
+
+        inline uint8_t modp(int x) const {
+            // Valid for x < 2^16
+            uint32_t t = c * x;
+            return ((uint64_t) t * p) >> 32;
+        }
+
+        inline uint8_t minus(uint8_t x) const { return x == 0 ? 0 : p - x; }
+
+        void rref_cols(int c0, int c1) {
+            // Split off panels from the left, then halve.
+            while (c1 - c0 > base_width) {
+                int w = c1 - c0;
+                int mid = c0 + (w > panel_width ? panel_width : w / 2);
+                int lw = mid - c0;
+
+                vector<uint8_t> saved((size_t) m * lw);
+                for (int i = 0; i < m; i++) {
+                    memcpy(saved.data() + (size_t) i * lw, row(i) + c0, lw);
+                }
+
+                int np0 = pivots.size();
+                rref_cols(c0, mid);
+                update_right(saved.data(), lw, c0, np0, mid, c1);
+
+                c0 = mid;
+            }
+
+            base(c0, c1);
+        }
+
+        void base(int c0, int c1) {
+            for (int col = c0; col < c1; col++) {
+                int r = -1;
+                for (int i = 0; i < m; i++) {
+                    if (!is_pivot[i] && row(i)[col] != 0) {
+                        r = i;
+                        break;
+                    }
+                }
+                if (r == -1) continue;
+
+                uint8_t *pr = row(r);
+                uint8_t x = inv_table[pr[col]];
+                for (int j = col; j < c1; j++) {
+                    pr[j] = modp(pr[j] * x);
+                }
+
+                for (int i = 0; i < m; i++) {
+                    uint8_t *ri = row(i);
+                    if (i == r || ri[col] == 0) continue;
+                    uint8_t s = minus(ri[col]);
+                    for (int j = col; j < c1; j++) {
+                        ri[j] = modp(ri[j] + s * pr[j]);
+                    }
+                }
+
+                is_pivot[r] = true;
+                pivots.push_back(std::make_pair(r, col));
+            }
+        }
+
+        void invert(vector<uint8_t> &S, int k) const {
+            // Gauss-Jordan inversion of the invertible k x k matrix S, in place.
+            int w = 2 * k;
+            vector<uint8_t> T((size_t) k * w, 0);
+            for (int i = 0; i < k; i++) {
+                memcpy(T.data() + (size_t) i * w, S.data() + (size_t) i * k, k);
+                T[(size_t) i * w + k + i] = 1;
+            }
+
+            for (int col = 0; col < k; col++) {
+                int r = col;
+                while (T[(size_t) r * w + col] == 0) r++;
+                if (r != col) {
+                    for (int j = 0; j < w; j++) std::swap(T[(size_t) r * w + j], T[(size_t) col * w + j]);
+                }
+
+                uint8_t *pr = T.data() + (size_t) col * w;
+                uint8_t x = inv_table[pr[col]];
+                for (int j = col; j < w; j++) pr[j] = modp(pr[j] * x);
+
+                for (int i = 0; i < k; i++) {
+                    uint8_t *ri = T.data() + (size_t) i * w;
+                    if (i == col || ri[col] == 0) continue;
+                    uint8_t s = minus(ri[col]);
+                    for (int j = col; j < w; j++) ri[j] = modp(ri[j] + s * pr[j]);
+                }
+            }
+
+            for (int i = 0; i < k; i++) {
+                memcpy(S.data() + (size_t) i * k, T.data() + (size_t) i * w + k, k);
+            }
+        }
+
+        void update_right(const uint8_t *saved, int lw, int c0, int np0, int r0, int r1) {
+            // Apply the reduction of columns [c0, c0 + lw), which selected pivots[np0..], to columns [r0, r1).
+            // saved holds columns [c0, c0 + lw) of every row before the reduction.
+            int k = pivots.size() - np0;
+            if (k == 0 || r0 >= r1) return;
+
+            vector<uint8_t *> prows(k);
+            vector<int> qc(k);
+            for (int a = 0; a < k; a++) {
+                prows[a] = row(pivots[np0 + a].first);
+                qc[a] = pivots[np0 + a].second - c0;
+            }
+
+            vector<uint8_t> S((size_t) k * k);
+            for (int a = 0; a < k; a++) {
+                const uint8_t *sr = saved + (size_t) pivots[np0 + a].first * lw;
+                for (int b = 0; b < k; b++) {
+                    S[(size_t) a * k + b] = sr[qc[b]];
+                }
+            }
+            invert(S, k);
+
+            vector<double> Sd((size_t) k * k);
+            for (size_t i = 0; i < Sd.size(); i++) Sd[i] = S[i];
+
+            // Rows, other than the new pivot rows, with a non-zero multiplier, and their negated multipliers.
+            vector<char> is_new_pivot(m, false);
+            for (int a = 0; a < k; a++) is_new_pivot[pivots[np0 + a].first] = true;
+
+            vector<uint8_t *> orows;
+            vector<double> Md;
+            for (int i = 0; i < m; i++) {
+                if (is_new_pivot[i]) continue;
+                const uint8_t *sr = saved + (size_t) i * lw;
+                bool any = false;
+                for (int b = 0; b < k && !any; b++) any = sr[qc[b]] != 0;
+                if (!any) continue;
+
+                orows.push_back(row(i));
+                for (int b = 0; b < k; b++) Md.push_back(minus(sr[qc[b]]));
+            }
+
+            vector<double> Bd;
+            for (int j0 = r0; j0 < r1; j0 += chunk_width) {
+                int w = min(chunk_width, r1 - j0);
+                Bd.resize((size_t) k * w);
+
+                // A[pi, right] = S^-1 A[pi, right]
+                for (int a = 0; a < k; a++) {
+                    for (int j = 0; j < w; j++) Bd[(size_t) a * w + j] = prows[a][j0 + j];
+                }
+                gemm_mod(k, w, k, Sd.data(), Bd.data(), prows.data(), j0, false);
+
+                // A[others, right] = A[others, right] - M A[pi, right]
+                if (!orows.empty()) {
+                    for (int a = 0; a < k; a++) {
+                        for (int j = 0; j < w; j++) Bd[(size_t) a * w + j] = prows[a][j0 + j];
+                    }
+                    gemm_mod(orows.size(), w, k, Md.data(), Bd.data(), orows.data(), j0, true);
+                }
+            }
+        }
+
+        void gemm_mod(int mm, int nn, int kk, const double *Ad, const double *Bd, uint8_t *const *C, int ccol,
+                      bool accumulate) const {
+            // C[i][ccol + j] = (C[i][ccol + j] + sum_l Ad[i][l] Bd[l][j]) mod p, or without the C term when
+            // not accumulating. Ad is mm x kk and Bd is kk x nn, both row-major and dense.
+            int nmb = (mm + gemm_mc - 1) / gemm_mc;
+            int nnb = (nn + gemm_nc - 1) / gemm_nc;
+            double pd = p;
+            double invp = 1. / p;
+
+#pragma omp parallel for schedule(dynamic) default(none) shared(mm, nn, kk, Ad, Bd, C, ccol, accumulate, nmb, nnb, pd, invp, gemm_mc, gemm_nc)
+            for (int t = 0; t < nmb * nnb; t++) {
+                int i0 = (t / nnb) * gemm_mc;
+                int j0 = (t % nnb) * gemm_nc;
+                int mc = min(gemm_mc, mm - i0);
+                int nc = min(gemm_nc, nn - j0);
+
+                double acc[gemm_mc * gemm_nc];
+                for (int i = 0; i < mc; i++) {
+                    for (int j = 0; j < nc; j++) {
+                        acc[i * gemm_nc + j] = accumulate ? C[i0 + i][ccol + j0 + j] : 0.;
+                    }
+                }
+
+                int mc4 = mc - mc % 4;
+                int nc8 = nc - nc % 8;
+
+                // 4 x 8 register tile
+                for (int i = 0; i < mc4; i += 4) {
+                    const double *a0 = Ad + (size_t) (i0 + i) * kk;
+                    const double *a1 = a0 + kk;
+                    const double *a2 = a1 + kk;
+                    const double *a3 = a2 + kk;
+
+                    for (int j = 0; j < nc8; j += 8) {
+                        double *c0 = acc + i * gemm_nc + j;
+                        __m256d c00 = _mm256_loadu_pd(c0);
+                        __m256d c01 = _mm256_loadu_pd(c0 + 4);
+                        __m256d c10 = _mm256_loadu_pd(c0 + gemm_nc);
+                        __m256d c11 = _mm256_loadu_pd(c0 + gemm_nc + 4);
+                        __m256d c20 = _mm256_loadu_pd(c0 + 2 * gemm_nc);
+                        __m256d c21 = _mm256_loadu_pd(c0 + 2 * gemm_nc + 4);
+                        __m256d c30 = _mm256_loadu_pd(c0 + 3 * gemm_nc);
+                        __m256d c31 = _mm256_loadu_pd(c0 + 3 * gemm_nc + 4);
+
+                        const double *b = Bd + j0 + j;
+                        for (int l = 0; l < kk; l++, b += nn) {
+                            __m256d b0 = _mm256_loadu_pd(b);
+                            __m256d b1 = _mm256_loadu_pd(b + 4);
+                            __m256d a;
+
+                            a = _mm256_broadcast_sd(a0 + l);
+                            c00 = _mm256_fmadd_pd(a, b0, c00);
+                            c01 = _mm256_fmadd_pd(a, b1, c01);
+                            a = _mm256_broadcast_sd(a1 + l);
+                            c10 = _mm256_fmadd_pd(a, b0, c10);
+                            c11 = _mm256_fmadd_pd(a, b1, c11);
+                            a = _mm256_broadcast_sd(a2 + l);
+                            c20 = _mm256_fmadd_pd(a, b0, c20);
+                            c21 = _mm256_fmadd_pd(a, b1, c21);
+                            a = _mm256_broadcast_sd(a3 + l);
+                            c30 = _mm256_fmadd_pd(a, b0, c30);
+                            c31 = _mm256_fmadd_pd(a, b1, c31);
+                        }
+
+                        _mm256_storeu_pd(c0, c00);
+                        _mm256_storeu_pd(c0 + 4, c01);
+                        _mm256_storeu_pd(c0 + gemm_nc, c10);
+                        _mm256_storeu_pd(c0 + gemm_nc + 4, c11);
+                        _mm256_storeu_pd(c0 + 2 * gemm_nc, c20);
+                        _mm256_storeu_pd(c0 + 2 * gemm_nc + 4, c21);
+                        _mm256_storeu_pd(c0 + 3 * gemm_nc, c30);
+                        _mm256_storeu_pd(c0 + 3 * gemm_nc + 4, c31);
+                    }
+                }
+
+                // Edges
+                for (int i = 0; i < mc; i++) {
+                    const double *ai = Ad + (size_t) (i0 + i) * kk;
+                    for (int j = (i < mc4 ? nc8 : 0); j < nc; j++) {
+                        double s = acc[i * gemm_nc + j];
+                        for (int l = 0; l < kk; l++) {
+                            s += ai[l] * Bd[(size_t) l * nn + j0 + j];
+                        }
+                        acc[i * gemm_nc + j] = s;
+                    }
+                }
+
+                for (int i = 0; i < mc; i++) {
+                    uint8_t *ci = C[i0 + i] + ccol + j0;
+                    for (int j = 0; j < nc; j++) {
+                        double v = acc[i * gemm_nc + j];
+                        double r = v - floor(v * invp) * pd;
+                        if (r < 0) r += pd;
+                        else if (r >= pd) r -= pd;
+                        ci[j] = (uint8_t) r;
+                    }
+                }
+            }
+        }
+    };
+
+    void dense_rref(unsigned char *A, int m, int n, int lda, unsigned char p,
+                    vector<char> &is_pivot, vector<pair<int, int> > &pivots) {
+        Dense d(A, m, n, lda, p, is_pivot, pivots);
+        d.rref();
+    }
+
+}
@@ -0,0 +1,22 @@
+//
+// Dense reduced row echelon form over GF(p) with matrix product trailing updates.
+//
+
+#ifndef ALBERT_MATRIX_REDUCE_PLUQ_H
+#define ALBERT_MATRIX_REDUCE_PLUQ_H
+
+#include <vector>
+#include <utility>
+
+namespace MatrixReducePLUQ {
+
+    // Reduce the dense m x n matrix A, row-major with leading dimension lda and entries in [0, p),
+    // to reduced row echelon form in place, without moving rows. Rows with is_pivot[i] set are not
+    // selected as pivots, but are reduced like any other row; rows selected as pivots are marked.
+    // The new pivots are appended to pivots as (row, column) pairs, in increasing column order.
+    void dense_rref(unsigned char *A, int m, int n, int lda, unsigned char p,
+                    std::vector<char> &is_pivot, std::vector<std::pair<int, int> > &pivots);
+
+}
+
+#endif //ALBERT_MATRIX_REDUCE_PLUQ_H
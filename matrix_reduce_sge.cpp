@@ -0,0 +1,291 @@
+//
+// Structured Gaussian elimination pre-pass for the truncated-dense AVX reducer.
+//
+// While the matrix is still sparse, rows are eliminated in sparse form, choosing the cheapest pivots by
+// Markowitz cost, (row nz - 1) x (column nz - 1), so singleton columns and short rows go first. Only the
+// remaining "core" rows are compacted to the columns they use and handed to SparseReduceMatrix8.
+//
+// A pivot is always taken at the leading column of its row. A row with a leading column c shows that
+// c is a pivot column of the reduced row echelon form, whichever row is chosen, so the pre-pass pivots
+// and the core pivots together are exactly the pivot columns of the matrix. The pre-pass only eliminates
+// the pivot column from the remaining rows, so the core rows come back fully reduced, and the pre-pass
+// rows are back-substituted afterwards, in decreasing pivot column order.
+//
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+#include <stdio.h>
+
+#include "matrix_reduce_sge.h"
+#include "matrix_reduce_avx.h"
+#include "Build_defs.h"
+#include "Scalar_arithmetic.h"
+#include "profile.h"
+
+namespace MatrixReduceSGE {
+
+    using std::vector;
+    using std::pair;
+    using std::make_pair;
+    using std::priority_queue;
+
+    // Pivots with a greater Markowitz cost are left to the core.
+    static long max_cost = 256;
+
+    static void axpy(const SparseRow &x, Scalar s, const SparseRow &r, SparseRow &out) {
+        // out = x + s * r
+        out.clear();
+        out.reserve(x.size() + r.size());
+
+        auto i = x.begin();
+        auto j = r.begin();
+        while (i != x.end() || j != r.end()) {
+            if (j == r.end() || (i != x.end() && i->getColumn() < j->getColumn())) {
+                out.push_back(*i++);
+            } else if (i == x.end() || j->getColumn() < i->getColumn()) {
+                out.push_back(Node(S_mul(s, j->getElement()), j->getColumn()));
+                j++;
+            } else {
+                Scalar v = S_add(i->getElement(), S_mul(s, j->getElement()));
+                if (v != 0) out.push_back(Node(v, i->getColumn()));
+                i++;
+                j++;
+            }
+        }
+    }
+
+    static Scalar element(const SparseRow &x, int c) {
+        auto it = std::lower_bound(x.begin(), x.end(), c,
+                                   [](const Node &n, int c_) { return n.getColumn() < c_; });
+        return it != x.end() && it->getColumn() == c ? it->getElement() : 0;
+    }
+
+    static void normalize(SparseRow &r) {
+        Scalar x = r.front().getElement();
+        if (x != 1) {
+            Scalar y = S_inv(x);
+            for (auto &n : r) n.setElement(S_mul(n.getElement(), y));
+        }
+    }
+
+    class Prepass {
+    public:
+        Prepass(SparseMatrix &SM_, int nCols_, long cost_limit_) : SM(SM_), nCols(nCols_), cost_limit(cost_limit_),
+                                                                   colcount(nCols_, 0), col_rows(nCols_),
+                                                                   active(SM_.size(), false),
+                                                                   version(SM_.size(), 0), queue() {}
+
+        // Eliminate cheap pivots, returning the pivot rows in the order they were selected.
+        vector<int> run() {
+            for (int i = 0; i < (int) SM.size(); i++) {
+                if (SM[i].empty()) continue;
+                active[i] = true;
+                for (const auto &n : SM[i]) {
+                    colcount[n.getColumn()]++;
+                    col_rows[n.getColumn()].push_back(i);
+                }
+            }
+            for (int i = 0; i < (int) SM.size(); i++) {
+                if (active[i]) queue.push(make_pair(cost(i), make_pair(i, version[i])));
+            }
+
+            vector<int> pivots;
+            SparseRow tmp;
+
+            while (!queue.empty()) {
+                long c0 = queue.top().first;
+                int r = queue.top().second.first;
+                int v = queue.top().second.second;
+                queue.pop();
+
+                if (!active[r] || v != version[r]) continue;
+
+                // Column counts may have grown since the row was queued.
+                long c1 = cost(r);
+                if (c1 > c0) {
+                    queue.push(make_pair(c1, make_pair(r, v)));
+                    continue;
+                }
+                if (cost_limit >= 0 && c1 > cost_limit) break;
+
+                int c = SM[r].front().getColumn();
+                normalize(SM[r]);
+                active[r] = false;
+                for (const auto &n : SM[r]) colcount[n.getColumn()]--;
+                pivots.push_back(r);
+
+                for (int x : col_rows[c]) {
+                    if (!active[x]) continue;
+                    Scalar s = element(SM[x], c);
+                    if (s == 0) continue;
+
+                    axpy(SM[x], S_minus(s), SM[r], tmp);
+
+                    for (const auto &n : SM[x]) colcount[n.getColumn()]--;
+                    {
+                        // Register x with the columns it gained
+                        auto i = SM[x].begin();
+                        for (const auto &n : tmp) {
+                            colcount[n.getColumn()]++;
+                            for (; i != SM[x].end() && i->getColumn() < n.getColumn(); i++) {
+                            }
+                            if (i == SM[x].end() || i->getColumn() != n.getColumn()) {
+                                col_rows[n.getColumn()].push_back(x);
+                            }
+                        }
+                    }
+                    SM[x].swap(tmp);
+                    version[x]++;
+
+                    if (SM[x].empty()) {
+                        active[x] = false;
+                    } else {
+                        queue.push(make_pair(cost(x), make_pair(x, version[x])));
+                    }
+                }
+                vector<int>().swap(col_rows[c]);
+            }
+
+            return pivots;
+        }
+
+        bool is_active(int i) const { return active[i]; }
+
+    private:
+        SparseMatrix &SM;
+        int nCols;
+        long cost_limit;
+        vector<int> colcount;
+        vector<vector<int> > col_rows;
+        vector<char> active;
+        vector<int> version;
+        priority_queue<pair<long, pair<int, int> >, vector<pair<long, pair<int, int> > >,
+                std::greater<pair<long, pair<int, int> > > > queue;
+
+        long cost(int i) const {
+            return long(SM[i].size() - 1) * (colcount[SM[i].front().getColumn()] - 1);
+        }
+    };
+
+    void back_substitute(SparseRow &r, const vector<SparseRow> &final_of_col, vector<int> &acc,
+                         vector<int> &touched) {
+        int lead = r.front().getColumn();
+        bool any = false;
+        for (const auto &n : r) {
+            if (n.getColumn() != lead && !final_of_col[n.getColumn()].empty()) {
+                any = true;
+                break;
+            }
+        }
+        if (!any) return;
+
+        touched.clear();
+        for (const auto &n : r) {
+            acc[n.getColumn()] = n.getElement();
+            touched.push_back(n.getColumn());
+        }
+        for (const auto &n : r) {
+            int c = n.getColumn();
+            if (c == lead || final_of_col[c].empty()) continue;
+            Scalar s = S_minus(n.getElement());
+            for (const auto &m : final_of_col[c]) {
+                int c2 = m.getColumn();
+                if (acc[c2] == -1) {
+                    acc[c2] = 0;
+                    touched.push_back(c2);
+                }
+                acc[c2] = S_add(acc[c2], S_mul(s, m.getElement()));
+            }
+        }
+
+        std::sort(touched.begin(), touched.end());
+        r.clear();
+        for (int c : touched) {
+            if (acc[c] != 0) r.push_back(Node(acc[c], c));
+            acc[c] = -1;
+        }
+    }
+
+}
+
+int MatrixReduceSGE::reduce(SparseMatrix &SM, int nCols, int *Rank, long cost_limit, bool verbose) {
+    int nRows = SM.size();
+
+    Prepass pp(SM, nCols, cost_limit);
+    vector<int> pivots = pp.run();
+
+    // Compact the core to the columns it uses.
+    vector<int> col_map(nCols, -1);
+    vector<int> col_unmap;
+    SparseMatrix core;
+    for (int i = 0; i < nRows; i++) {
+        if (!pp.is_active(i)) continue;
+        for (const auto &n : SM[i]) col_map[n.getColumn()] = 0;
+    }
+    for (int c = 0; c < nCols; c++) {
+        if (col_map[c] == 0) {
+            col_map[c] = col_unmap.size();
+            col_unmap.push_back(c);
+        }
+    }
+    for (int i = 0; i < nRows; i++) {
+        if (!pp.is_active(i)) continue;
+        core.push_back(SparseRow());
+        core.back().swap(SM[i]);
+        for (auto &n : core.back()) n.setColumn(col_map[n.getColumn()]);
+    }
+
+    if (verbose) {
+        printf("\t\tSGE: %d pivots, core %d x %d\n", (int) pivots.size(), (int) core.size(), (int) col_unmap.size());
+    }
+
+    vector<SparseRow> final_of_col(nCols);
+
+    if (!core.empty()) {
+        int core_rank = 0;
+        SparseReduceMatrix8(core, col_unmap.size(), &core_rank);
+        for (auto &row : core) {
+            if (row.empty()) continue;
+            for (auto &n : row) n.setColumn(col_unmap[n.getColumn()]);
+            int c = row.front().getColumn();
+            final_of_col[c].swap(row);
+        }
+        core.clear();
+    }
+
+    {
+        vector<pair<int, int> > order;
+        for (int r : pivots) {
+            order.push_back(make_pair(SM[r].front().getColumn(), r));
+        }
+        std::sort(order.rbegin(), order.rend());
+
+        vector<int> acc(nCols, -1);
+        vector<int> touched;
+        for (const auto &o : order) {
+            SparseRow &r = SM[o.second];
+            back_substitute(r, final_of_col, acc, touched);
+            final_of_col[o.first].swap(r);
+        }
+    }
+
+    SM.clear();
+    SM.resize(nRows);
+    *Rank = 0;
+    for (int c = 0; c < nCols; c++) {
+        if (!final_of_col[c].empty()) {
+            SM[(*Rank)++].swap(final_of_col[c]);
+        }
+    }
+
+    return 1;
+}
+
+int SparseReduceMatrix10(SparseMatrix &SM, int nCols, int *Rank) {
+    Profile p1("SparseReduceMatrix10");
+
+    return MatrixReduceSGE::reduce(SM, nCols, Rank, MatrixReduceSGE::max_cost, true);
+}
@@ -0,0 +1,29 @@
+//
+// Structured Gaussian elimination pre-pass for the truncated-dense AVX reducer.
+//
+
+#ifndef ALBERT_MATRIX_REDUCE_SGE_H
+#define ALBERT_MATRIX_REDUCE_SGE_H
+
+#include "CreateMatrix.h"
+
+int SparseReduceMatrix10(SparseMatrix &SM, int nCols, int *Rank);
+
+namespace MatrixReduceSGE {
+
+    // Reduce SM, pivoting in sparse form while the Markowitz cost is at most cost_limit, and reducing the
+    // remaining core with SparseReduceMatrix8. With a negative cost_limit everything is reduced in sparse
+    // form, and nothing is printed or shared between threads, so independent matrices can be reduced
+    // concurrently.
+    int reduce(SparseMatrix &SM, int nCols, int *Rank, long cost_limit, bool verbose);
+
+    // r = r - sum of r[c] * final_of_col[c], over the pivot columns c after the leading column of r, where
+    // final_of_col[c] is the fully reduced row with leading column c, or empty if c is not a pivot column.
+    // The final rows are zero in every other pivot column, so a single pass suffices. acc is scratch space
+    // of one entry per column, all -1, and is left that way.
+    void back_substitute(SparseRow &r, const std::vector<SparseRow> &final_of_col, std::vector<int> &acc,
+                         std::vector<int> &touched);
+
+}
+
+#endif //ALBERT_MATRIX_REDUCE_SGE_H
@@ -0,0 +1,425 @@
+//
+// Black-box reduction of type matrices by Wiedemann's method.
+//
+// The matrix is only touched through sparse matrix-vector products, so it is never filled in. With random
+// non-singular diagonal D1 and D2, A' = D2 A D1, compacted to the used columns, and B = A'^T A', the
+// minimal generating polynomial f = x^a g of the sequence u B^i v, found by Berlekamp-Massey, divides the
+// minimal polynomial of B. That gives a certified lower bound of the rank, deg g + max(a - 1, 0) <= rank B
+// <= rank A. Kernel vectors of A are sampled as the last non-zero B^j g(B) v, and kept if A' y = 0.
+//
+// The reduced row echelon form is determined by the kernel. Reduced to echelon form with the pivots taken
+// at the last non-zero column, the kernel vectors are, for each free column f, v_f with v_f[f] = 1, zero at
+// the other free columns and -R[p][f] at the pivot columns p < f. Once as many independent kernel vectors
+// are found as the rank bound allows, the rank is certified and R is read off the kernel. Otherwise, which
+// happens mostly for small primes, the matrix is reduced by SparseReduceMatrix8 instead.
+//
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "matrix_reduce_wiedemann.h"
+#include "matrix_reduce_avx.h"
+#include "Build_defs.h"
+#include "Scalar_arithmetic.h"
+#include "profile.h"
+
+namespace MatrixReduceWiedemann {
+
+    using std::vector;
+    using std::pair;
+    using std::make_pair;
+
+    // Kernel vectors sampled beyond its expected dimension
+    static int extra = 16;
+    // Largest kernel dimension, and number of multiplications, sampling it, beyond which elimination is
+    // cheaper.
+    static int max_nullity = 4096;
+    static double max_work = 2e10;
+    // Berlekamp-Massey stops early once the generator has not changed for this many terms.
+    static int margin = 20;
+    // Matrices with at most this many rows times columns are also reduced by SparseReduceMatrix8, and the
+    // results compared.
+    static long check_cells = 1L << 20;
+    static unsigned int seed = 0x5eed;
+
+    // Y = M X, for s vectors stored interleaved, X[c * s + j].
+    static void mul_block(const SparseMatrix &M, const vector<Scalar> &X, vector<Scalar> &Y, int s) {
+        const uint32_t p = S_prime();
+        Y.resize(M.size() * s);
+
+#pragma omp parallel shared(M, X, Y, s, p) default(none) copyin(Current_field)
+        {
+            vector<uint32_t> acc(s);
+#pragma omp for schedule(dynamic, 64)
+            for (int i = 0; i < (int) M.size(); i++) {
+                if (s == 1) {
+                    uint32_t a = 0;
+                    int k = 0;
+                    for (const auto &n : M[i]) {
+                        a += n.getElement() * X[n.getColumn()];
+                        if (++k == 65535) {
+                            a %= p;
+                            k = 0;
+                        }
+                    }
+                    Y[i] = a % p;
+                    continue;
+                }
+                std::fill(acc.begin(), acc.end(), 0);
+                int k = 0;
+                for (const auto &n : M[i]) {
+                    uint32_t e = n.getElement();
+                    const Scalar *x = &X[(size_t) n.getColumn() * s];
+                    for (int j = 0; j < s; j++) acc[j] += e * x[j];
+                    // (p - 1)^2 < 2^16, so 2^16 - 1 products are summed before reducing.
+                    if (++k == 65535) {
+                        for (int j = 0; j < s; j++) acc[j] %= p;
+                        k = 0;
+                    }
+                }
+                for (int j = 0; j < s; j++) Y[(size_t) i * s + j] = acc[j] % p;
+            }
+        }
+    }
+
+    // non_zero[j] whether column j of the r x s X is non-zero
+    static void zero_columns(const vector<Scalar> &X, int r, int s, vector<char> &non_zero) {
+        std::fill(non_zero.begin(), non_zero.end(), false);
+        for (int i = 0; i < r; i++) {
+            for (int j = 0; j < s; j++) non_zero[j] |= X[(size_t) i * s + j] != 0;
+        }
+    }
+
+    static Scalar dot(const vector<Scalar> &u, const vector<Scalar> &v) {
+        uint32_t acc = 0;
+        for (size_t i = 0; i < u.size(); i++) {
+            acc += u[i] * v[i];
+            if ((i & 0xffff) == 0xffff) acc %= S_prime();
+        }
+        return acc % S_prime();
+    }
+
+    // Berlekamp-Massey: the shortest C, C[0] = 1, with sum_i C[i] s[k - i] = 0 for L <= k < s.size()
+    class BerlekampMassey {
+    public:
+        BerlekampMassey() : s(), C(1, 1), B(1, 1), L(0), m(1), b(1), last_change(0) {}
+
+        void push(Scalar x) {
+            int k = s.size();
+            s.push_back(x);
+
+            Scalar d = x;
+            for (int i = 1; i <= L; i++) d = S_add(d, S_mul(C[i], s[k - i]));
+            if (d == 0) {
+                m++;
+                return;
+            }
+
+            bool grow = 2 * L <= k;
+            vector<Scalar> T;
+            if (grow) T = C;
+            if (C.size() < B.size() + m) C.resize(B.size() + m, 0);
+            Scalar coef = S_minus(S_mul(d, S_inv(b)));
+            for (size_t i = 0; i < B.size(); i++) C[i + m] = S_add(C[i + m], S_mul(coef, B[i]));
+
+            if (grow) {
+                L = k + 1 - L;
+                B.swap(T);
+                b = d;
+                m = 1;
+                last_change = k;
+            } else {
+                m++;
+            }
+        }
+
+        // The generating polynomial, f[j] the coefficient of x^j, f[L] = 1
+        vector<Scalar> generator() const {
+            vector<Scalar> f(L + 1, 0);
+            for (int j = 0; j <= L && L - j < (int) C.size(); j++) f[j] = C[L - j];
+            return f;
+        }
+
+        int length() const { return L; }
+
+        int terms() const { return s.size(); }
+
+        int stable() const { return s.size() - 1 - last_change; }
+
+    private:
+        vector<Scalar> s;
+        vector<Scalar> C;
+        vector<Scalar> B;
+        int L;
+        int m;
+        Scalar b;
+        int last_change;
+    };
+
+    // Kernel vectors in echelon form, pivoting at their last non-zero column.
+    class Echelon {
+    public:
+        Echelon() : vecs() {}
+
+        // Add v if independent of the vectors so far.
+        bool add(vector<Scalar> &v) {
+            // By decreasing pivot, each step only changes columns before the pivot.
+            for (const auto &e : vecs) {
+                int c = e.first;
+                if (v[c] == 0) continue;
+                Scalar s = S_minus(v[c]);
+                axpy(v, s, e.second, c);
+            }
+
+            int c = v.size() - 1;
+            while (c >= 0 && v[c] == 0) c--;
+            if (c < 0) return false;
+
+            Scalar y = S_inv(v[c]);
+            for (int i = 0; i <= c; i++) v[i] = S_mul(v[i], y);
+
+            auto it = vecs.begin();
+            while (it != vecs.end() && it->first > c) ++it;
+            vecs.insert(it, make_pair(c, vector<Scalar>()))->second.swap(v);
+            return true;
+        }
+
+        // Clear the pivot columns of the other vectors.
+        void reduce() {
+            for (int k = vecs.size() - 1; k >= 0; k--) {
+                auto &v = vecs[k].second;
+                for (int l = vecs.size() - 1; l > k; l--) {
+                    int c = vecs[l].first;
+                    if (v[c] == 0) continue;
+                    axpy(v, S_minus(v[c]), vecs[l].second, c);
+                }
+            }
+        }
+
+        int size() const { return vecs.size(); }
+
+        // By decreasing pivot
+        const vector<pair<int, vector<Scalar> > > &vectors() const { return vecs; }
+
+    private:
+        vector<pair<int, vector<Scalar> > > vecs;
+
+        static void axpy(vector<Scalar> &v, Scalar s, const vector<Scalar> &e, int last) {
+            for (int i = 0; i <= last; i++) v[i] = _modp(v[i] + s * e[i]);
+        }
+    };
+
+    class BlackBox {
+    public:
+        BlackBox(const SparseMatrix &A_, int n) : A(A_), AT(n), t() {
+            for (int i = 0; i < (int) A.size(); i++) {
+                for (const auto &n_ : A[i]) AT[n_.getColumn()].push_back(Node(n_.getElement(), i));
+            }
+        }
+
+        // Y = A^T A X
+        void apply(const vector<Scalar> &X, vector<Scalar> &Y, int s) {
+            mul_block(A, X, t, s);
+            mul_block(AT, t, Y, s);
+        }
+
+    private:
+        const SparseMatrix &A;
+        SparseMatrix AT;
+        vector<Scalar> t;
+    };
+
+    static int reduce(SparseMatrix &SM, int nCols, int *Rank) {
+        int nRows = SM.size();
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> any(0, S_prime() - 1);
+        std::uniform_int_distribution<int> non_zero(1, S_prime() - 1);
+
+        // A' = D2 A D1, compacted to the used columns
+        vector<int> col_map(nCols, -1);
+        vector<int> col_unmap;
+        for (const auto &row : SM) {
+            for (const auto &n : row) col_map[n.getColumn()] = 0;
+        }
+        for (int c = 0; c < nCols; c++) {
+            if (col_map[c] != -1) {
+                col_map[c] = col_unmap.size();
+                col_unmap.push_back(c);
+            }
+        }
+        int n = col_unmap.size();
+
+        vector<Scalar> d1(n);
+        for (auto &x : d1) x = non_zero(rng);
+
+        SparseMatrix A;
+        for (const auto &row : SM) {
+            if (row.empty()) continue;
+            Scalar d2 = non_zero(rng);
+            A.push_back(SparseRow());
+            for (const auto &n_ : row) {
+                int c = col_map[n_.getColumn()];
+                A.back().push_back(Node(S_mul(S_mul(d2, n_.getElement()), d1[c]), c));
+            }
+        }
+        int m = A.size();
+        long nnz = 0;
+        for (const auto &row : A) nnz += row.size();
+
+        if (n == 0) {
+            *Rank = 0;
+            return OK;
+        }
+
+        BlackBox bb(A, n);
+
+        // The minimal generating polynomial of u B^i v
+        BerlekampMassey bm;
+        {
+            Profile p2("Wiedemann sequence");
+
+            vector<Scalar> u(n), v(n), w;
+            for (auto &x : u) x = any(rng);
+            for (auto &x : v) x = any(rng);
+            int max_terms = 2 * (std::min(m, n) + 1);
+            for (int k = 0; k < max_terms; k++) {
+                bm.push(dot(u, v));
+                // A generator with a non-zero constant term is only trusted once complete.
+                if (bm.stable() >= margin && bm.terms() >= 2 * bm.length() + margin &&
+                    bm.generator()[0] == 0) {
+                    break;
+                }
+                bb.apply(v, w, 1);
+                v.swap(w);
+            }
+        }
+
+        vector<Scalar> f = bm.generator();
+        int L = bm.length();
+        int a = 0;
+        while (a < L && f[a] == 0) a++;
+        vector<Scalar> g(f.begin() + a, f.end());
+        int deg = L - a;
+        int rank_bound = deg + std::max(a - 1, 0);
+        int nullity = n - rank_bound;
+
+        printf("\t\tWiedemann: %d x %d, generator degree %d, rank >= %d\n", m, n, L, rank_bound);
+
+        // Sampling costs deg products of B by nullity + extra vectors.
+        double work = 2. * nnz * deg * (nullity + extra);
+        if (nullity > max_nullity || work > max_work) {
+            printf("\t\tWiedemann: kernel too large, falling back\n");
+            return SparseReduceMatrix8(SM, nCols, Rank);
+        }
+
+        // Sample the kernel, with a few more vectors than its dimension, all at once.
+        Echelon kernel;
+        if (nullity > 0) {
+            Profile p2("Wiedemann kernel");
+
+            const int s = nullity + extra;
+            vector<Scalar> V(n * s), W, T, Z, Prev, Y(n * s, 0);
+            for (auto &x : V) x = any(rng);
+
+            // W = g(B) V, g being monic
+            W = V;
+            for (int i = deg - 1; i >= 0; i--) {
+                bb.apply(W, T, s);
+                for (size_t k = 0; k < W.size(); k++) W[k] = _modp(T[k] + g[i] * V[k]);
+            }
+
+            // The last non-zero B^j W, if B^(j+1) W = 0 within a few more steps than a
+            vector<char> done(s, false);
+            vector<char> found(s, false);
+            vector<char> non_zero_col(s);
+            Z.swap(W);
+            for (int t = 0; t <= a + 4; t++) {
+                zero_columns(Z, n, s, non_zero_col);
+                int left = 0;
+                for (int j = 0; j < s; j++) {
+                    if (done[j]) continue;
+                    if (!non_zero_col[j]) {
+                        done[j] = true;
+                        if (t > 0) {
+                            found[j] = true;
+                            for (int c = 0; c < n; c++) Y[c * s + j] = Prev[c * s + j];
+                        }
+                    } else {
+                        left++;
+                    }
+                }
+                if (left == 0) break;
+                Prev.swap(Z);
+                bb.apply(Prev, Z, s);
+            }
+
+            // Keep the vectors with A' y = 0, as A D1 y = 0.
+            mul_block(A, Y, T, s);
+            zero_columns(T, m, s, non_zero_col);
+            for (int j = 0; j < s && kernel.size() < nullity; j++) {
+                if (!found[j] || non_zero_col[j]) continue;
+                vector<Scalar> x(n);
+                for (int c = 0; c < n; c++) x[c] = S_mul(d1[c], Y[c * s + j]);
+                kernel.add(x);
+            }
+        }
+
+        if (kernel.size() < nullity) {
+            printf("\t\tWiedemann: found %d of %d kernel vectors, falling back\n", kernel.size(), nullity);
+            return SparseReduceMatrix8(SM, nCols, Rank);
+        }
+
+        kernel.reduce();
+
+        // R[p][f] = -v_f[p]
+        vector<char> is_free(n, false);
+        for (const auto &v : kernel.vectors()) is_free[v.first] = true;
+
+        SM.clear();
+        SM.resize(nRows);
+        vector<int> row_of_col(n, -1);
+        *Rank = 0;
+        for (int c = 0; c < n; c++) {
+            if (is_free[c]) continue;
+            row_of_col[c] = *Rank;
+            SM[(*Rank)++].push_back(Node(1, col_unmap[c]));
+        }
+        for (auto it = kernel.vectors().rbegin(); it != kernel.vectors().rend(); ++it) {
+            int fc = it->first;
+            const auto &v = it->second;
+            for (int c = 0; c < fc; c++) {
+                if (v[c] != 0) SM[row_of_col[c]].push_back(Node(S_minus(v[c]), col_unmap[fc]));
+            }
+        }
+
+        return OK;
+    }
+
+}
+
+int SparseReduceMatrix12(SparseMatrix &SM, int nCols, int *Rank) {
+    using namespace MatrixReduceWiedemann;
+
+    Profile p1("SparseReduceMatrix12");
+
+    SparseMatrix check;
+    bool checking = (long) SM.size() * nCols <= check_cells;
+    if (checking) check = SM;
+
+    int status = reduce(SM, nCols, Rank);
+
+    if (checking) {
+        int rank = 0;
+        int status_ = SparseReduceMatrix8(check, nCols, &rank);
+        if (status != status_ || *Rank != rank || SM != check) {
+            printf("ERROR: Wiedemann reduction differs from truncated-dense-avx.\n");
+            abort();
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,12 @@
+//
+// Black-box reduction of type matrices by Wiedemann's method.
+//
+
+#ifndef ALBERT_MATRIX_REDUCE_WIEDEMANN_H
+#define ALBERT_MATRIX_REDUCE_WIEDEMANN_H
+
+#include "CreateMatrix.h"
+
+int SparseReduceMatrix12(SparseMatrix &SM, int nCols, int *Rank);
+
+#endif //ALBERT_MATRIX_REDUCE_WIEDEMANN_H
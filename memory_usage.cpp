@@ -18,9 +18,9 @@ using std::fill;
 using std::pair;
 using std::make_pair;
 
-int memory_usage0;
-double t0;
-vector<pair<double, int> > memory_usage;
+static thread_local int memory_usage0;
+static thread_local double t0;
+thread_local vector<pair<double, int> > memory_usage;
 
 size_t current_memory_usage() {
 #if defined(__linux__) && defined(PROFILE_MEMORY)
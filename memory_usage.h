@@ -8,7 +8,8 @@
 
 #include <vector>
 
-extern std::vector<std::pair<double, int> > memory_usage;
+// Recorded by the thread reducing a matrix, so sessions may reduce concurrently.
+extern thread_local std::vector<std::pair<double, int> > memory_usage;
 
 void memory_usage_init(int n);
 
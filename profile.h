@@ -30,11 +30,11 @@ inline int gettimeofday(struct timeval *tv, void * /*tz*/) {
 #endif
 
 struct Profile {
-    Profile(const char *str) : rank(-1), name(str) {
+    Profile(const char *str) : rank(-1), name(str), tv_start(), stopped_(false) {
         restart();
     }
 
-    Profile(int rank_, const char *str) : rank(rank_), name(str) {
+    Profile(int rank_, const char *str) : rank(rank_), name(str), tv_start(), stopped_(false) {
         restart();
     }
 
@@ -0,0 +1,83 @@
+#!/bin/bash
+
+# Runs one of the fixed-input problems in tests/regress and compares the
+# basis and multiplication tables it saves against those saved by the
+# baseline build. Any checkpoint files in tests/regress are copied next to
+# the run so a case can restore them.
+#
+# Usage: regress.sh [-e] <albert binary> <case> [message]
+#
+# With -e, for toggles that may choose another basis, only the number of
+# basis elements of each type is compared, and every polynomial the case
+# asks about with "p" must be an identity. With a message, the output of
+# albert must also contain it.
+#
+# Environment toggles such as ALBERT_ORBITS are passed through to albert.
+
+equivalent=0
+if [ "$1" = "-e" ]; then
+    equivalent=1
+    shift
+fi
+
+if [ $# -lt 2 ] || [ $# -gt 3 ]; then
+    echo "Usage: $0 [-e] <albert binary> <case> [message]"
+    exit 2
+fi
+
+albert=$(readlink -f "$1")
+dir=$(dirname "$(readlink -f "$0")")/regress
+name=$2
+message=$3
+
+if [ ! -f "$dir/$name.in" ]; then
+    echo "No such case: $dir/$name.in"
+    exit 2
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+cp "$dir"/*.bin "$work" 2>/dev/null
+cd "$work" || exit 2
+
+if ! "$albert" < "$dir/$name.in" > log 2>&1; then
+    cat log
+    echo "$name: albert exited with an error"
+    exit 1
+fi
+
+# The number of basis elements of each type, the fourth column of the basis table.
+dimensions() {
+    awk 'NR > 1 { print $4 }' "$1" | sort | uniq -c
+}
+
+status=0
+if [ $equivalent -eq 1 ]; then
+    if [ "$(dimensions "$dir/$name.basis")" != "$(dimensions basis.out)" ]; then
+        echo "$name: the types have other dimensions than in the baseline"
+        status=1
+    fi
+    if grep -q "is not an identity" log; then
+        echo "$name: a consequence of the identities does not hold"
+        status=1
+    fi
+else
+    for table in basis mult; do
+        if ! cmp "$dir/$name.$table" "$table.out"; then
+            echo "$name: $table table differs from the baseline"
+            status=1
+        fi
+    done
+fi
+
+if [ -n "$message" ] && ! grep -qF -- "$message" log; then
+    echo "$name: albert did not print \"$message\""
+    status=1
+fi
+
+if [ $status -ne 0 ]; then
+    cat log
+fi
+
+exit $status
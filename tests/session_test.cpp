@@ -0,0 +1,151 @@
+//
+// Builds two problems in separate sessions, first one after the other and then concurrently, and checks
+// that the concurrent builds save the same basis and multiplication tables.
+//
+
+#include <list>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+
+#include "Basis_table.h"
+#include "Build.h"
+#include "Build_defs.h"
+#include "Generators.h"
+#include "Id_routines.h"
+#include "Memory_routines.h"
+#include "Mult_table.h"
+#include "Po_create_poly.h"
+#include "Po_routines.h"
+#include "Session.h"
+
+using std::list;
+using std::string;
+
+Scalar Field = DEFAULT_FIELD;
+int sigIntFlag = 0;
+jmp_buf env;
+
+struct Problem {
+    Scalar field;
+    const char *identities[4];
+    const char *generators;
+};
+
+static const Problem problems[] = {
+        {251, {"(xy)z-(yx)z", nullptr}, "aabbc"},
+        {3,   {"ab-ba", "(xx)(xx)", "((xx)x)x", nullptr}, "aabbc"},
+};
+
+/* A problem entered in a session of its own, as the driver does. */
+class Run {
+public:
+    explicit Run(const Problem &p) : session(p.field), ids(), target(nullptr), tables() {
+        SessionScope scope(session);
+
+        for (int i = 0; p.identities[i]; i++) {
+            string s = p.identities[i];
+            int len = 0;
+            int out_of_memory = FALSE;
+            struct polynomial *id = Create_poly(&s[0], &len, &out_of_memory);
+            if (!id || !Homogeneous(id)) {
+                printf("Unable to enter %s\n", p.identities[i]);
+                exit(1);
+            }
+            AssignNumbersToLetters(id);
+            Add_id(id, p.identities[i], ids);
+        }
+
+        string g = p.generators;
+        P_type ptype;
+        Parse_generator_word(&g[0], &ptype);
+        AssignBasisNumberstoLetters(ptype);
+
+        int n = 0;
+        Degree degrees[NUM_LETTERS + 1];
+        for (int i = 0; i < NUM_LETTERS; i++) {
+            if (ptype.degrees[i] > 0) degrees[n++] = ptype.degrees[i];
+        }
+        degrees[n++] = 0;
+        target = (Type) Mymalloc(n * sizeof(Degree));
+        for (int i = 0; i < n; i++) target[i] = degrees[i];
+    }
+
+    ~Run() {
+        SessionScope scope(session);
+        Remove_all_ids(ids);
+        free(target);
+    }
+
+    Run(const Run &) = delete;
+    Run &operator=(const Run &) = delete;
+
+    /* Build the table and keep the tables it saves. */
+    bool build() {
+        if (Build(session, ids, target) != OK) return false;
+
+        SessionScope scope(session);
+        char *buf = nullptr;
+        size_t len = 0;
+        FILE *f = open_memstream(&buf, &len);
+        PrintBasisTable(f);
+        Print_MultTable(f);
+        fclose(f);
+        tables.assign(buf, len);
+        free(buf);
+        return true;
+    }
+
+    Session session;
+    list<id_queue_node> ids;
+    Type target;
+    string tables;
+};
+
+int main() {
+    const int n = sizeof(problems) / sizeof(problems[0]);
+
+    Run *serial[n];
+    for (int i = 0; i < n; i++) {
+        serial[i] = new Run(problems[i]);
+        if (!serial[i]->build()) {
+            printf("Build %d failed\n", i);
+            return 1;
+        }
+    }
+
+    Run *concurrent[n];
+    for (int i = 0; i < n; i++) {
+        concurrent[i] = new Run(problems[i]);
+    }
+
+    bool ok[n];
+    std::thread threads[n];
+    for (int i = 0; i < n; i++) {
+        threads[i] = std::thread([&concurrent, &ok, i]() { ok[i] = concurrent[i]->build(); });
+    }
+    for (int i = 0; i < n; i++) {
+        threads[i].join();
+    }
+
+    int status = 0;
+    for (int i = 0; i < n; i++) {
+        if (!ok[i]) {
+            printf("Concurrent build %d failed\n", i);
+            status = 1;
+        } else if (concurrent[i]->tables != serial[i]->tables) {
+            printf("Concurrent build %d saved different tables\n", i);
+            status = 1;
+        }
+        delete serial[i];
+        delete concurrent[i];
+    }
+
+    if (status == 0) {
+        printf("Concurrent sessions saved the same tables\n");
+    }
+
+    return status;
+}